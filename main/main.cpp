@@ -22,6 +22,19 @@ int main(int argc, char const *argv[]) {
       .names({"-o", "--output"})
       .description("Optimized snapshot output")
       .required(false);
+  argparser.add_argument()
+      .names({"--unroll-max-size"})
+      .description("Instruction budget of loop unrolling, 0 disables it")
+      .required(false);
+  argparser.add_argument()
+      .names({"-r", "--regalloc"})
+      .description("Register allocator: linear-scan (default) or "
+                   "graph-coloring")
+      .required(false);
+  argparser.add_argument()
+      .names({"--strip-line-info"})
+      .description("Remove every line info marker")
+      .required(false);
 
   argparser.enable_help();
 
@@ -58,11 +71,56 @@ int main(int argc, char const *argv[]) {
     return 2;
   }
 
+  uint32_t unroll_max_size = argparser.exists("unroll-max-size")
+                                 ? argparser.get<uint32_t>("unroll-max-size")
+                                 : LOOP_UNROLL_MAX_SIZE;
+
+  optimizer::Pass *regalloc;
+  std::string regalloc_name = argparser.exists("r")
+                                  ? argparser.get<std::string>("r")
+                                  : "linear-scan";
+
+  if (regalloc_name == "linear-scan") {
+    regalloc = new optimizer::RegallocLinearScan();
+  } else if (regalloc_name == "graph-coloring") {
+    regalloc = new optimizer::RegallocGraphColoring();
+  } else {
+    std::cerr << "Unknown register allocator: " << regalloc_name << std::endl;
+    return 2;
+  }
+
   optimizer::Optimizer optimizer(read_res.list());
-  optimizer.addPass(new optimizer::ControlFlowAnalysis())
+  optimizer.addPass(new optimizer::BranchSimplification())
+      .addPass(new optimizer::ControlFlowAnalysis())
+      .addPass(new optimizer::IdentPromotion())
+      .addPass(new optimizer::BlockMerging())
+      .addPass(new optimizer::ConstantPropagation())
+      .addPass(new optimizer::DominatorAnalysis())
+      .addPass(new optimizer::LoopAnalysis())
+      .addPass(new optimizer::LoopRotation())
+      .addPass(new optimizer::LoopUnrolling(LOOP_UNROLL_MAX_TRIP_COUNT,
+                                            unroll_max_size))
+      .addPass(new optimizer::ConstantPropagation())
+      .addPass(new optimizer::BlockMerging())
       .addPass(new optimizer::DominatorAnalysis())
+      .addPass(new optimizer::LoopAnalysis())
+      .addPass(new optimizer::TdzElimination())
+      .addPass(new optimizer::BlockContextElimination())
+      .addPass(new optimizer::GlobalValueNumbering())
+      .addPass(new optimizer::LoopInvariantCodeMotion())
+      .addPass(new optimizer::UnusedResultElimination())
+      .addPass(new optimizer::StringConcatFolding())
+      .addPass(new optimizer::Peephole())
+      .addPass(new optimizer::NumberLiteralCanonicalization())
+      .addPass(new optimizer::ArgumentsElimination())
+      .addPass(new optimizer::FunctionInlining())
       .addPass(new optimizer::LivenessAnalysis())
-      .addPass(new optimizer::RegallocLinearScan());
+      .addPass(regalloc)
+      .addPass(new optimizer::BlockLayout())
+      .addPass(new optimizer::LineInfoMinimization(
+          argparser.exists("strip-line-info")))
+      .addPass(new optimizer::LiteralPoolCompaction())
+      .addPass(new optimizer::LiteralPoolReorder());
   optimizer.run();
 
   std::string out;
@@ -0,0 +1,111 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "arguments-elimination.h"
+#include "optimizer.h"
+#include "scope-analysis.h"
+
+namespace optimizer {
+
+ArgumentsElimination::ArgumentsElimination() : Pass() {}
+
+ArgumentsElimination::~ArgumentsElimination() {}
+
+bool ArgumentsElimination::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::CONTROL_FLOW_ANALYSIS));
+
+  Ins *create = nullptr;
+
+  for (auto ins : byte_code->instructions()) {
+    if (ins->opcode().opcodeData().groupOpcode() != VM_OC_CREATE_ARGUMENTS) {
+      continue;
+    }
+
+    if (create != nullptr) {
+      return true;
+    }
+
+    create = ins;
+  }
+
+  if (create == nullptr || isUsed(byte_code, create) ||
+      isCaptured(optimizer, byte_code, create)) {
+    return true;
+  }
+
+  LOG("Remove unused arguments object: " << *create);
+  byte_code->removeIns(create);
+
+  if (byte_code->flags().mappedArgumentsNeeded()) {
+    byte_code->removeMappedArguments();
+  }
+
+  return true;
+}
+
+/**
+ * The arguments object escapes through any other instruction which refers
+ * to its binding, or through an eval which may refer to it by name
+ */
+bool ArgumentsElimination::isUsed(Bytecode *byte_code, Ins *create) {
+  LiteralIndex binding = create->argument().literals().front().index();
+
+  for (auto ins : byte_code->instructions()) {
+    if (ins == create) {
+      continue;
+    }
+
+    if (ScopeAnalysis::isDynamicScope(ins)) {
+      return true;
+    }
+
+    for (auto &literal : ins->argument().literals()) {
+      if (literal.index() == binding) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Nested functions may only refer to an identifier binding by its name
+ */
+bool ArgumentsElimination::isCaptured(Optimizer *optimizer,
+                                      Bytecode *byte_code, Ins *create) {
+  LiteralIndex binding = create->argument().literals().front().index();
+  bool is_register = binding < byte_code->args().registerEnd();
+
+  for (auto function : optimizer->list()) {
+    if (!ScopeAnalysis::isDescendant(function, byte_code)) {
+      continue;
+    }
+
+    if (ScopeAnalysis::hasDynamicScope(function)) {
+      return true;
+    }
+
+    if (is_register) {
+      continue;
+    }
+
+    BytecodeArguments &args = function->args();
+
+    for (LiteralIndex i = args.registerEnd(); i < args.identEnd(); i++) {
+      if (function->literalPool().at(i) ==
+          byte_code->literalPool().at(binding)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+} // namespace optimizer
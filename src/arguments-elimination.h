@@ -0,0 +1,40 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef ARGUMENTS_ELIMINATION_H
+#define ARGUMENTS_ELIMINATION_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class ArgumentsElimination : public Pass {
+public:
+  ArgumentsElimination();
+  ~ArgumentsElimination();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "ArgumentsElimination"; }
+
+  virtual PassKind kind() { return PassKind::ARGUMENTS_ELIMINATION; }
+
+private:
+  bool isUsed(Bytecode *byte_code, Ins *create);
+  bool isCaptured(Optimizer *optimizer, Bytecode *byte_code, Ins *create);
+};
+
+} // namespace optimizer
+
+#endif // ARGUMENTS_ELIMINATION_H
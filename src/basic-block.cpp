@@ -14,6 +14,19 @@ void BasicBlock::addIns(Ins *inst) {
   inst->setBasicBlock(this);
 }
 
+/**
+ * First jump of the block, nullptr if the block falls through
+ */
+Ins *BasicBlock::terminator() {
+  for (auto ins : insns()) {
+    if (ins->isJump()) {
+      return ins;
+    }
+  }
+
+  return nullptr;
+}
+
 void BasicBlock::addPredecessor(BasicBlock *bb) {
   LOG("Add " << bb->id() << " to " << this->id() << " as pred");
   predecessors().push_back(bb);
@@ -61,7 +74,7 @@ bool BasicBlock::removePredecessor(const BasicBlockID id) {
 }
 
 bool BasicBlock::removeSuccessor(const BasicBlockID id) {
-  BasicBlock *succ;
+  BasicBlock *succ = nullptr;
   bool deleted = false;
   successors().erase(
       std::remove_if(successors().begin(), successors().end(),
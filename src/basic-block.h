@@ -28,7 +28,8 @@ using PredecessorTraverser = SuccessorTraverser;
 class BasicBlock {
 public:
   BasicBlock() : BasicBlock(INVALID_BASIC_BLOCK_ID) {}
-  BasicBlock(BasicBlockID id) : idom_(nullptr), flags_(0), id_(id) {}
+  BasicBlock(BasicBlockID id)
+      : idom_(nullptr), loop_depth_(0), flags_(0), id_(id) {}
 
   auto &predecessors() { return predecessors_; }
   auto &successors() { return successors_; }
@@ -45,6 +46,8 @@ public:
 
   auto &locals() { return locals_; }
 
+  auto &loopDepth() { return loop_depth_; }
+
   bool isValid() const {
     return (flags_ & static_cast<uint32_t>(BasicBlockFlags::INVALID)) == 0;
   };
@@ -52,6 +55,7 @@ public:
   bool isEmpty() const { return insts_.empty(); }
   bool isInaccessible() const { return predecessors_.empty(); }
 
+  Ins *terminator();
   void addIns(Ins *inst);
   void addPredecessor(BasicBlock *bb);
   void addSuccessor(BasicBlock *bb);
@@ -146,6 +150,9 @@ private:
   // RegallocLinearScan
   RegSet locals_;
 
+  // LoopAnalysis
+  uint32_t loop_depth_;
+
   uint32_t flags_;
   BasicBlockID id_;
 };
@@ -0,0 +1,197 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "block-context-elimination.h"
+#include "dominator-analysis.h"
+#include "optimizer.h"
+#include "scope-analysis.h"
+
+namespace optimizer {
+
+BlockContextElimination::BlockContextElimination() : Pass() {}
+
+BlockContextElimination::~BlockContextElimination() {}
+
+bool BlockContextElimination::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::DOMINATOR_ANALYSIS));
+
+#if ENABLED(JERRY_ESNEXT)
+  if (!TdzElimination::collectClosures(optimizer, byte_code, closures_)) {
+    return true;
+  }
+
+  for (auto ins : byte_code->instructions()) {
+    if (ScopeAnalysis::isDynamicScope(ins)) {
+      return true;
+    }
+  }
+
+  /* an outer block can only be eliminated after its inner blocks */
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+
+    for (auto ins : byte_code->instructions()) {
+      if (ins->opcode().opcodeData().groupOpcode() ==
+              VM_OC_BLOCK_CREATE_CONTEXT &&
+          ins->argument().type() == OperandType::BRANCH &&
+          eliminate(byte_code, ins)) {
+        changed = true;
+        break;
+      }
+    }
+  }
+#endif /* ENABLED (JERRY_ESNEXT) */
+
+  return true;
+}
+
+#if ENABLED(JERRY_ESNEXT)
+/**
+ * Move the bindings of the block into registers and remove its context
+ */
+bool BlockContextElimination::eliminate(Bytecode *byte_code, Ins *create) {
+  Ins *end = contextEnd(byte_code, create);
+
+  if (end == nullptr) {
+    return false;
+  }
+
+  InsList &insns = byte_code->instructions();
+  InsList region(std::next(std::find(insns.begin(), insns.end(), create)),
+                 std::find(insns.begin(), insns.end(), end));
+  std::vector<LiteralIndex> bindings;
+
+  for (auto ins : region) {
+    switch (ins->opcode().opcodeData().groupOpcode()) {
+    case VM_OC_BLOCK_CREATE_CONTEXT:
+    case VM_OC_WITH:
+    case VM_OC_TRY:
+    case VM_OC_CLONE_CONTEXT:
+    case VM_OC_INIT_ARG_OR_FUNC: {
+      return false;
+    }
+    case VM_OC_CREATE_BINDING: {
+      if (!ins->opcode().is(CBC_CREATE_LET) &&
+          !ins->opcode().is(CBC_CREATE_CONST)) {
+        return false;
+      }
+      break;
+    }
+    case VM_OC_INIT_BINDING: {
+      if (!ins->opcode().is(CBC_INIT_LET) &&
+          !ins->opcode().is(CBC_INIT_CONST)) {
+        return false;
+      }
+      break;
+    }
+    default: {
+      continue;
+    }
+    }
+
+    LiteralIndex binding = TdzElimination::binding(ins);
+
+    if (std::find(bindings.begin(), bindings.end(), binding) ==
+        bindings.end()) {
+      bindings.push_back(binding);
+    }
+  }
+
+  for (auto binding : bindings) {
+    if (!isPromotable(byte_code, region, binding)) {
+      return false;
+    }
+  }
+
+  LOG("Remove block context: " << *create);
+
+  for (size_t i = 0; i < bindings.size(); i++) {
+    ScopeAnalysis::promote(byte_code, region, bindings[i]);
+
+    /* the identifiers move up by one with each new register */
+    for (size_t j = i + 1; j < bindings.size(); j++) {
+      bindings[j]++;
+    }
+  }
+
+  byte_code->removeIns(create);
+  byte_code->removeIns(end);
+  return true;
+}
+
+/**
+ * The context of a block ends right before the target of its branch
+ */
+Ins *BlockContextElimination::contextEnd(Bytecode *byte_code, Ins *create) {
+  Ins *target =
+      byte_code->insAt(create->offset() + create->argument().branchOffset());
+  Ins *end = byte_code->previous(target);
+
+  if (end == nullptr ||
+      end->opcode().opcodeData().groupOpcode() != VM_OC_CONTEXT_END) {
+    return nullptr;
+  }
+
+  return end;
+}
+
+/**
+ * The binding is initialized once, before every use of it, and it is not
+ * referenced by a closure
+ */
+bool BlockContextElimination::isPromotable(Bytecode *byte_code,
+                                           InsList &region,
+                                           LiteralIndex binding) {
+  ecma_value_t name = byte_code->literalPool().at(binding);
+
+  for (auto ins : region) {
+    for (auto &literal : ins->argument().literals()) {
+      auto iter = closures_.find(literal.index());
+
+      if (iter != closures_.end() && iter->second.count(name) != 0) {
+        return false;
+      }
+    }
+  }
+
+  IdentAccesses accesses;
+
+  if (!ScopeAnalysis::isPromotable(region, binding, accesses) ||
+      accesses.initializations.size() != 1) {
+    return false;
+  }
+
+  /* registers have no temporal dead zone */
+  Ins *init = accesses.initializations[0];
+  InsList &uses = accesses.uses;
+  bool initialized = false;
+
+  for (auto ins : region) {
+    if (ins == init) {
+      initialized = true;
+      continue;
+    }
+
+    if (std::find(uses.begin(), uses.end(), ins) == uses.end()) {
+      continue;
+    }
+
+    if (ins->bb() == init->bb()
+            ? !initialized
+            : !DominatorAnalysis::dominatedBy(ins->bb(), init->bb())) {
+      return false;
+    }
+  }
+
+  return true;
+}
+#endif /* ENABLED (JERRY_ESNEXT) */
+
+} // namespace optimizer
@@ -0,0 +1,45 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef BLOCK_CONTEXT_ELIMINATION_H
+#define BLOCK_CONTEXT_ELIMINATION_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+#include "tdz-elimination.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class BlockContextElimination : public Pass {
+public:
+  BlockContextElimination();
+  ~BlockContextElimination();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "BlockContextElimination"; }
+
+  virtual PassKind kind() { return PassKind::BLOCK_CONTEXT_ELIMINATION; }
+
+private:
+  bool eliminate(Bytecode *byte_code, Ins *create);
+  Ins *contextEnd(Bytecode *byte_code, Ins *create);
+  bool isPromotable(Bytecode *byte_code, InsList &region,
+                    LiteralIndex binding);
+
+  ClosureIdents closures_;
+};
+
+} // namespace optimizer
+
+#endif // BLOCK_CONTEXT_ELIMINATION_H
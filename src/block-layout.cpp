@@ -0,0 +1,371 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "block-layout.h"
+#include "loop-analysis.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+BlockLayout::BlockLayout() : Pass() {}
+
+BlockLayout::~BlockLayout() {}
+
+bool BlockLayout::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::LOOP_ANALYSIS));
+
+  blocks_.clear();
+  fallthrough_.clear();
+  next_.clear();
+  prev_.clear();
+
+  if (!isSupported(byte_code)) {
+    LOG("Block layout skipped");
+    return true;
+  }
+
+  buildChains(byte_code);
+
+  BasicBlockList order = placeChains();
+  rewrite(byte_code, order);
+  fixDirections(byte_code);
+
+  return true;
+}
+
+/**
+ * Contexts cover an offset range, so they pin the layout. Only the plain
+ * jumps and the invertible branches are retargeted.
+ */
+bool BlockLayout::isSupported(Bytecode *byte_code) {
+  size_t count = 0;
+
+  for (auto bb : byte_code->basicBlockList()) {
+    if (!bb->isValid()) {
+      continue;
+    }
+
+    if (bb->isEmpty()) {
+      return false;
+    }
+
+    count += bb->insns().size();
+    blocks_.push_back(bb);
+  }
+
+  /* every instruction has to move together with its block */
+  if (blocks_.empty() || count != byte_code->instructions().size()) {
+    return false;
+  }
+
+  for (auto ins : byte_code->instructions()) {
+    if (ins->isTryContext() ||
+        (ins->argument().type() == OperandType::BRANCH && !ins->isJump())) {
+      return false;
+    }
+
+    if (!ins->isJump()) {
+      continue;
+    }
+
+    switch (ins->opcode().opcodeData().groupOpcode()) {
+    case VM_OC_JUMP:
+    case VM_OC_BRANCH_IF_TRUE:
+    case VM_OC_BRANCH_IF_FALSE: {
+      break;
+    }
+    default: {
+      return false;
+    }
+    }
+  }
+
+  /* the last block has nothing to fall through to */
+  Ins *last = blocks_.back()->terminator();
+
+  if (last != nullptr ? last->isConditionalJump()
+                      : fallsThrough(blocks_.back())) {
+    return false;
+  }
+
+  for (size_t i = 0; i + 1 < blocks_.size(); i++) {
+    fallthrough_[blocks_[i]] = blocks_[i + 1];
+  }
+
+  return true;
+}
+
+/**
+ * Link the blocks into chains which are laid out as fall-through sequences.
+ * Blocks without a jump keep their successor, conditional branches prefer the
+ * likely successor, unconditional jumps come last.
+ */
+void BlockLayout::buildChains(Bytecode *byte_code) {
+  BasicBlockList branches;
+  BasicBlockList jumps;
+
+  for (auto bb : blocks_) {
+    Ins *jump = bb->terminator();
+
+    if (jump == nullptr) {
+      if (fallsThrough(bb)) {
+        link(bb, fallthrough_[bb]);
+      }
+    } else if (jump->isConditionalJump()) {
+      branches.push_back(bb);
+    } else {
+      jumps.push_back(bb);
+    }
+  }
+
+  /* inner loops are placed first */
+  std::stable_sort(branches.begin(), branches.end(),
+                   [](BasicBlock *a, BasicBlock *b) {
+                     return a->loopDepth() > b->loopDepth();
+                   });
+
+  for (auto bb : branches) {
+    BasicBlock *taken =
+        byte_code->insAt(bb->terminator()->jumpTarget())->bb();
+    BasicBlock *fallthrough = fallthrough_[bb];
+    BasicBlock *likely = likelySuccessor(byte_code, bb, taken, fallthrough);
+
+    if (!link(bb, likely)) {
+      link(bb, likely == taken ? fallthrough : taken);
+    }
+  }
+
+  for (auto bb : jumps) {
+    link(bb, byte_code->insAt(bb->terminator()->jumpTarget())->bb());
+  }
+}
+
+bool BlockLayout::link(BasicBlock *from, BasicBlock *to) {
+  if (to == nullptr || to == blocks_.front() || next_.count(from) != 0 ||
+      prev_.count(to) != 0) {
+    return false;
+  }
+
+  /* 'to' heads its chain, which must not end in 'from' */
+  for (BasicBlock *bb = to; bb != nullptr;) {
+    if (bb == from) {
+      return false;
+    }
+
+    auto iter = next_.find(bb);
+    bb = iter == next_.end() ? nullptr : iter->second;
+  }
+
+  next_[from] = to;
+  prev_[to] = from;
+  return true;
+}
+
+/**
+ * Static prediction: throwing paths are cold, loop back edges are taken and
+ * loop exits are not, otherwise the original fall-through is kept
+ */
+BasicBlock *BlockLayout::likelySuccessor(Bytecode *byte_code, BasicBlock *bb,
+                                         BasicBlock *taken,
+                                         BasicBlock *fallthrough) {
+  if (fallthrough == nullptr || isCold(taken) != isCold(fallthrough)) {
+    return isCold(taken) ? fallthrough : taken;
+  }
+
+  for (auto loop : byte_code->loops()) {
+    if (!loop->contains(bb)) {
+      continue;
+    }
+
+    if (loop->header() == taken || loop->header() == fallthrough) {
+      return loop->header();
+    }
+
+    if (loop->contains(taken) != loop->contains(fallthrough)) {
+      return loop->contains(taken) ? taken : fallthrough;
+    }
+  }
+
+  return fallthrough;
+}
+
+/**
+ * The chain of the entry block comes first, the cold chains last, the others
+ * keep their original order
+ */
+BasicBlockList BlockLayout::placeChains() {
+  BasicBlockList hot;
+  BasicBlockList cold;
+
+  for (auto bb : blocks_) {
+    if (prev_.count(bb) != 0) {
+      continue;
+    }
+
+    BasicBlockList &list = isCold(bb) ? cold : hot;
+
+    for (BasicBlock *member = bb; member != nullptr;) {
+      list.push_back(member);
+
+      auto iter = next_.find(member);
+      member = iter == next_.end() ? nullptr : iter->second;
+    }
+  }
+
+  hot.insert(hot.end(), cold.begin(), cold.end());
+  return hot;
+}
+
+void BlockLayout::rewrite(Bytecode *byte_code, BasicBlockList &order) {
+  InsList &insns = byte_code->instructions();
+  BasicBlockList &bbs = byte_code->basicBlockList();
+
+  /* the code after a terminator would be reached once its jump is removed */
+  for (auto bb : order) {
+    InsList dead;
+
+    for (auto ins : bb->insns()) {
+      if (ins->hasFlag(InstFlags::DEAD)) {
+        dead.push_back(ins);
+      }
+    }
+
+    for (auto ins : dead) {
+      byte_code->removeIns(ins);
+    }
+  }
+
+  insns.clear();
+
+  for (auto bb : order) {
+    insns.insert(insns.end(), bb->insns().begin(), bb->insns().end());
+  }
+
+  BasicBlockList layout = {bbs.front()};
+  layout.insert(layout.end(), order.begin(), order.end());
+
+  for (auto bb : bbs) {
+    if (!bb->isValid() && bb != bbs.front()) {
+      layout.push_back(bb);
+    }
+  }
+
+  bbs = layout;
+
+  for (size_t i = 0; i < order.size(); i++) {
+    BasicBlock *bb = order[i];
+    BasicBlock *next = i + 1 < order.size() ? order[i + 1] : nullptr;
+    Ins *jump = bb->terminator();
+
+    if (jump == nullptr) {
+      continue;
+    }
+
+    BasicBlock *taken = byte_code->insAt(jump->jumpTarget())->bb();
+
+    if (!jump->isConditionalJump()) {
+      if (taken == next) {
+        LOG("Remove jump: " << *jump);
+        byte_code->removeIns(jump);
+      }
+      continue;
+    }
+
+    BasicBlock *fallthrough = fallthrough_[bb];
+
+    if (fallthrough == next) {
+      continue;
+    }
+
+    Ins *target = fallthrough->insns().front();
+    int32_t offset = static_cast<int32_t>(target->offset()) -
+                     static_cast<int32_t>(jump->offset());
+
+    if (taken == next) {
+      GroupOpcode group = jump->opcode().opcodeData().groupOpcode();
+      LOG("Invert branch: " << *jump);
+
+      jump->opcode() = Opcode::directed(group == VM_OC_BRANCH_IF_TRUE
+                                            ? VM_OC_BRANCH_IF_FALSE
+                                            : VM_OC_BRANCH_IF_TRUE,
+                                        false);
+      jump->argument().setBranchOffset(offset);
+      continue;
+    }
+
+    /* neither successor follows the branch */
+    Ins *fix = Ins::create(byte_code, Opcode(CBC_JUMP_FORWARD), {});
+    fix->argument().setBranchOffset(offset);
+    byte_code->insertInsAfter(jump, fix);
+  }
+}
+
+/**
+ * The branch offsets still refer to the original offsets, which the emitter
+ * resolves. Only the direction of the opcodes follows the new order.
+ */
+void BlockLayout::fixDirections(Bytecode *byte_code) {
+  std::unordered_map<Ins *, size_t> positions;
+  InsList &insns = byte_code->instructions();
+
+  for (size_t i = 0; i < insns.size(); i++) {
+    positions[insns[i]] = i;
+  }
+
+  for (auto ins : insns) {
+    if (!ins->isJump()) {
+      continue;
+    }
+
+    Ins *target = byte_code->insAt(ins->jumpTarget());
+    bool backward = positions[target] < positions[ins];
+    OpcodeData data = ins->opcode().opcodeData();
+
+    if (backward != data.isBackwardBrach()) {
+      ins->opcode() = Opcode::directed(data.groupOpcode(), backward);
+    }
+  }
+}
+
+bool BlockLayout::isCold(BasicBlock *bb) {
+  for (auto ins : bb->insns()) {
+    switch (ins->opcode().opcodeData().groupOpcode()) {
+    case VM_OC_THROW:
+    case VM_OC_THROW_REFERENCE_ERROR:
+    case VM_OC_THROW_CONST_ERROR:
+    case VM_OC_THROW_SYNTAX_ERROR: {
+      return true;
+    }
+    default: {
+      break;
+    }
+    }
+  }
+
+  return false;
+}
+
+/**
+ * The block continues with the following one, unless it leaves the function
+ */
+bool BlockLayout::fallsThrough(BasicBlock *bb) {
+  switch (bb->insns().back()->opcode().opcodeData().groupOpcode()) {
+  case VM_OC_RETURN:
+  case VM_OC_THROW:
+  case VM_OC_THROW_REFERENCE_ERROR:
+  case VM_OC_THROW_CONST_ERROR:
+  case VM_OC_THROW_SYNTAX_ERROR: {
+    return false;
+  }
+  default: {
+    return true;
+  }
+  }
+}
+
+} // namespace optimizer
@@ -0,0 +1,56 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef BLOCK_LAYOUT_H
+#define BLOCK_LAYOUT_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class BlockLayout : public Pass {
+public:
+  BlockLayout();
+  ~BlockLayout();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "BlockLayout"; }
+
+  virtual PassKind kind() { return PassKind::BLOCK_LAYOUT; }
+
+private:
+  bool isSupported(Bytecode *byte_code);
+  void buildChains(Bytecode *byte_code);
+  bool link(BasicBlock *from, BasicBlock *to);
+  BasicBlock *likelySuccessor(Bytecode *byte_code, BasicBlock *bb,
+                              BasicBlock *taken, BasicBlock *fallthrough);
+  BasicBlockList placeChains();
+  void rewrite(Bytecode *byte_code, BasicBlockList &order);
+  void fixDirections(Bytecode *byte_code);
+
+  static bool isCold(BasicBlock *bb);
+  static bool fallsThrough(BasicBlock *bb);
+
+  /* valid blocks in their original order */
+  BasicBlockList blocks_;
+  /* block following each block in the original order */
+  std::unordered_map<BasicBlock *, BasicBlock *> fallthrough_;
+  std::unordered_map<BasicBlock *, BasicBlock *> next_;
+  std::unordered_map<BasicBlock *, BasicBlock *> prev_;
+};
+
+} // namespace optimizer
+
+#endif // BLOCK_LAYOUT_H
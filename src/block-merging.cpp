@@ -0,0 +1,150 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "block-merging.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+BlockMerging::BlockMerging() : Pass() {}
+
+BlockMerging::~BlockMerging() {}
+
+bool BlockMerging::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::CONTROL_FLOW_ANALYSIS));
+
+  BasicBlockList &bbs = byte_code->basicBlockList();
+
+  for (size_t i = 0; i < bbs.size(); i++) {
+    BasicBlock *bb = bbs[i];
+    Ins *jump;
+
+    if (!bb->isValid()) {
+      continue;
+    }
+
+    /* the merged block may continue with the next one of the chain */
+    for (BasicBlock *succ = mergeable(byte_code, bb, jump); succ != nullptr;
+         succ = mergeable(byte_code, bb, jump)) {
+      merge(byte_code, bb, succ, jump);
+      i = std::find(bbs.begin(), bbs.end(), bb) - bbs.begin();
+    }
+  }
+
+  return true;
+}
+
+/**
+ * The single successor of 'bb' which has no other predecessor. Instruction
+ * offsets drive the live intervals, so only the successor which directly
+ * follows 'bb' is merged, the others are brought together by the block
+ * layout after register allocation.
+ */
+BasicBlock *BlockMerging::mergeable(Bytecode *byte_code, BasicBlock *bb,
+                                    Ins *&jump) {
+  if (bb->isEmpty() || bb->successors().empty()) {
+    return nullptr;
+  }
+
+  BasicBlock *succ = bb->successors().front();
+
+  for (auto other : bb->successors()) {
+    if (other != succ) {
+      return nullptr;
+    }
+  }
+
+  for (auto pred : succ->predecessors()) {
+    if (pred != bb) {
+      return nullptr;
+    }
+  }
+
+  if (succ == bb || !succ->isValid() || succ->isEmpty()) {
+    return nullptr;
+  }
+
+  Ins *target = succ->insns().front();
+  jump = bb->terminator();
+
+  if (jump != nullptr &&
+      (jump->isTryContext() ||
+       jump->opcode().opcodeData().groupOpcode() != VM_OC_JUMP ||
+       byte_code->insAt(jump->jumpTarget()) != target)) {
+    return nullptr;
+  }
+
+  if (byte_code->next(bb->insns().back()) != target ||
+      isTargeted(byte_code, target, jump)) {
+    return nullptr;
+  }
+
+  return succ;
+}
+
+void BlockMerging::merge(Bytecode *byte_code, BasicBlock *bb,
+                         BasicBlock *succ, Ins *jump) {
+  LOG("Merge BB: " << succ->id() << " into: " << bb->id());
+
+  if (jump != nullptr) {
+    /* the jump and the code after it is replaced by the successor */
+    InsList dead;
+
+    for (auto ins : bb->insns()) {
+      if (ins == jump || ins->hasFlag(InstFlags::DEAD)) {
+        dead.push_back(ins);
+      }
+    }
+
+    for (auto ins : dead) {
+      byte_code->removeIns(ins);
+    }
+  }
+
+  for (auto ins : succ->insns()) {
+    bb->addIns(ins);
+  }
+
+  succ->insns().clear();
+
+  BasicBlockList succs = succ->successors();
+  bb->removeSuccessor(succ->id());
+  succ->remove();
+
+  for (auto next_bb : succs) {
+    if (std::find(bb->successors().begin(), bb->successors().end(),
+                  next_bb) == bb->successors().end()) {
+      bb->addSuccessor(next_bb);
+    }
+  }
+
+  BasicBlockList &bbs = byte_code->basicBlockList();
+  bbs.erase(std::find(bbs.begin(), bbs.end(), succ));
+  delete succ;
+}
+
+/**
+ * Whether any branch other than 'jump' refers to 'target'
+ */
+bool BlockMerging::isTargeted(Bytecode *byte_code, Ins *target, Ins *jump) {
+  for (auto ins : byte_code->instructions()) {
+    if (ins == jump || ins->argument().type() != OperandType::BRANCH) {
+      continue;
+    }
+
+    int32_t offset = ins->offset() + ins->argument().branchOffset();
+
+    if (byte_code->insAt(offset) == target) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace optimizer
@@ -0,0 +1,43 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef BLOCK_MERGING_H
+#define BLOCK_MERGING_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class BlockMerging : public Pass {
+public:
+  BlockMerging();
+  ~BlockMerging();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "BlockMerging"; }
+
+  virtual PassKind kind() { return PassKind::BLOCK_MERGING; }
+
+private:
+  BasicBlock *mergeable(Bytecode *byte_code, BasicBlock *bb, Ins *&jump);
+  void merge(Bytecode *byte_code, BasicBlock *bb, BasicBlock *succ,
+             Ins *jump);
+
+  static bool isTargeted(Bytecode *byte_code, Ins *target, Ins *jump);
+};
+
+} // namespace optimizer
+
+#endif // BLOCK_MERGING_H
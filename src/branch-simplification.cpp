@@ -0,0 +1,274 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "branch-simplification.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+BranchSimplification::BranchSimplification() : Pass() {}
+
+BranchSimplification::~BranchSimplification() {}
+
+/**
+ * Runs on the linear instruction list, so the retargeted branches do not
+ * have to split the basic blocks
+ */
+bool BranchSimplification::run(Optimizer *optimizer, Bytecode *byte_code) {
+  InsList &insns = byte_code->instructions();
+
+  collectTargets(byte_code);
+
+  for (size_t i = 0; i < insns.size(); i++) {
+    Ins *branch = insns[i];
+    GroupOpcode group = branch->opcode().opcodeData().groupOpcode();
+
+    if (group == VM_OC_BRANCH_IF_LOGICAL_TRUE ||
+        group == VM_OC_BRANCH_IF_LOGICAL_FALSE) {
+      simplifyLogical(byte_code, branch);
+      group = branch->opcode().opcodeData().groupOpcode();
+    }
+
+    if (group != VM_OC_BRANCH_IF_TRUE && group != VM_OC_BRANCH_IF_FALSE) {
+      continue;
+    }
+
+    bool changed = false;
+
+    while (simplifyCondition(byte_code, branch)) {
+      changed = true;
+    }
+
+    /* the removed conditions preceded the branch */
+    if (changed) {
+      i = static_cast<size_t>(
+          std::find(insns.begin(), insns.end(), branch) - insns.begin());
+    }
+  }
+
+  return true;
+}
+
+void BranchSimplification::collectTargets(Bytecode *byte_code) {
+  targets_.clear();
+
+  for (auto ins : byte_code->instructions()) {
+    if (ins->argument().type() == OperandType::BRANCH) {
+      targets_.insert(
+          byte_code->insAt(ins->offset() + ins->argument().branchOffset()));
+    }
+  }
+}
+
+/**
+ * Rewrite the condition computed right before the branch
+ *
+ *   LOGICAL_NOT; BRANCH_IF_TRUE         -> BRANCH_IF_FALSE
+ *   cmp; PUSH_TRUE; STRICT_EQUAL;
+ *   BRANCH_IF_TRUE                      -> cmp; BRANCH_IF_TRUE
+ *   cmp; PUSH_FALSE; STRICT_EQUAL;
+ *   BRANCH_IF_TRUE                      -> cmp; BRANCH_IF_FALSE
+ *
+ * where 'cmp' pushes a boolean. Every instruction which is removed or
+ * follows a removed one must not be entered by a jump.
+ */
+bool BranchSimplification::simplifyCondition(Bytecode *byte_code,
+                                             Ins *branch) {
+  Ins *operand = byte_code->previous(branch);
+
+  if (operand == nullptr || targets_.count(branch) != 0) {
+    return false;
+  }
+
+  GroupOpcode group = branch->opcode().opcodeData().groupOpcode();
+  GroupOpcode inverted = group == VM_OC_BRANCH_IF_TRUE ? VM_OC_BRANCH_IF_FALSE
+                                                       : VM_OC_BRANCH_IF_TRUE;
+  Ins *target = byte_code->insAt(branch->jumpTarget());
+
+  if (target == operand) {
+    return false;
+  }
+
+  if (operand->opcode().is(CBC_LOGICAL_NOT)) {
+    LOG("Fold logical not into: " << *branch);
+    remove(byte_code, operand);
+    retarget(branch, inverted, target);
+    return true;
+  }
+
+  if (operand->opcode().is(CBC_LOGICAL_NOT_LITERAL)) {
+    LOG("Fold logical not into: " << *branch);
+    Ins *push = Ins::create(byte_code, Opcode(CBC_PUSH_LITERAL),
+                            operand->argument().literals());
+
+    if (targets_.erase(operand) != 0) {
+      targets_.insert(push);
+    }
+
+    byte_code->replaceIns(operand, push);
+    retarget(branch, inverted, target);
+    return true;
+  }
+
+  bool negated;
+
+  if (operand->opcode().is(CBC_STRICT_EQUAL)) {
+    negated = false;
+  } else if (operand->opcode().is(CBC_STRICT_NOT_EQUAL)) {
+    negated = true;
+  } else {
+    return false;
+  }
+
+  Ins *constant = byte_code->previous(operand);
+
+  if (constant == nullptr || target == constant ||
+      targets_.count(operand) != 0 || targets_.count(constant) != 0) {
+    return false;
+  }
+
+  if (constant->opcode().is(CBC_PUSH_FALSE)) {
+    negated = !negated;
+  } else if (!constant->opcode().is(CBC_PUSH_TRUE)) {
+    return false;
+  }
+
+  Ins *value = byte_code->previous(constant);
+
+  if (value == nullptr || !isBoolean(value)) {
+    return false;
+  }
+
+  LOG("Fold boolean comparison into: " << *branch);
+  remove(byte_code, operand);
+  remove(byte_code, constant);
+  retarget(branch, negated ? inverted : group, target);
+  return true;
+}
+
+/**
+ * A logical branch keeps its value only when it is taken. If the value is
+ * dropped or tested again at the target, the plain branch can jump straight
+ * to where the execution continues without it.
+ */
+bool BranchSimplification::simplifyLogical(Bytecode *byte_code, Ins *branch) {
+  bool truthy = branch->opcode().opcodeData().groupOpcode() ==
+                VM_OC_BRANCH_IF_LOGICAL_TRUE;
+  Ins *target =
+      resolve(byte_code, byte_code->insAt(branch->jumpTarget()), truthy);
+
+  if (target == nullptr) {
+    return false;
+  }
+
+  LOG("Simplify logical branch: " << *branch);
+  retarget(branch, truthy ? VM_OC_BRANCH_IF_TRUE : VM_OC_BRANCH_IF_FALSE,
+           target);
+  targets_.insert(target);
+  return true;
+}
+
+/**
+ * Instruction which continues the execution after 'ins' is reached with a
+ * value of the given truthiness on the stack and drops it, or nullptr if
+ * the value may be used
+ */
+Ins *BranchSimplification::resolve(Bytecode *byte_code, Ins *ins,
+                                   bool truthy) {
+  /* logical branches may form a cycle, which is cut by the limit */
+  for (size_t steps = byte_code->instructions().size(); steps > 0; steps--) {
+    if (ins->opcode().is(CBC_POP)) {
+      return byte_code->next(ins);
+    }
+
+    GroupOpcode group = ins->opcode().opcodeData().groupOpcode();
+
+    switch (group) {
+    case VM_OC_BRANCH_IF_TRUE:
+    case VM_OC_BRANCH_IF_FALSE: {
+      if ((group == VM_OC_BRANCH_IF_TRUE) == truthy) {
+        return byte_code->insAt(ins->jumpTarget());
+      }
+
+      return byte_code->next(ins);
+    }
+    case VM_OC_BRANCH_IF_LOGICAL_TRUE:
+    case VM_OC_BRANCH_IF_LOGICAL_FALSE: {
+      if ((group == VM_OC_BRANCH_IF_LOGICAL_TRUE) != truthy) {
+        return byte_code->next(ins);
+      }
+
+      /* the value is kept by the taken branch */
+      ins = byte_code->insAt(ins->jumpTarget());
+      break;
+    }
+    default: {
+      return nullptr;
+    }
+    }
+  }
+
+  return nullptr;
+}
+
+void BranchSimplification::remove(Bytecode *byte_code, Ins *ins) {
+  /* jumps to the removed instruction continue with the following one */
+  if (targets_.erase(ins) != 0) {
+    Ins *following = byte_code->next(ins);
+
+    if (following != nullptr) {
+      targets_.insert(following);
+    }
+  }
+
+  byte_code->removeIns(ins);
+}
+
+/**
+ * The offsets are resolved by the emitter, so the shortest form is used
+ */
+void BranchSimplification::retarget(Ins *branch, GroupOpcode group,
+                                    Ins *target) {
+  int32_t offset = static_cast<int32_t>(target->offset()) -
+                   static_cast<int32_t>(branch->offset());
+
+  branch->opcode() = Opcode::directed(group, offset < 0);
+  branch->argument().setBranchOffset(offset);
+}
+
+/**
+ * The instruction pushes the boolean result of a comparison
+ */
+bool BranchSimplification::isBoolean(Ins *ins) {
+  OpcodeData data = ins->opcode().opcodeData();
+
+  if (!data.isPutStack()) {
+    return false;
+  }
+
+  switch (data.groupOpcode()) {
+  case VM_OC_NOT:
+  case VM_OC_EQUAL:
+  case VM_OC_NOT_EQUAL:
+  case VM_OC_STRICT_EQUAL:
+  case VM_OC_STRICT_NOT_EQUAL:
+  case VM_OC_LESS:
+  case VM_OC_GREATER:
+  case VM_OC_LESS_EQUAL:
+  case VM_OC_GREATER_EQUAL:
+  case VM_OC_IN:
+  case VM_OC_INSTANCEOF: {
+    return true;
+  }
+  default: {
+    return false;
+  }
+  }
+}
+
+} // namespace optimizer
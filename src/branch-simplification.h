@@ -0,0 +1,48 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef BRANCH_SIMPLIFICATION_H
+#define BRANCH_SIMPLIFICATION_H
+
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class BranchSimplification : public Pass {
+public:
+  BranchSimplification();
+  ~BranchSimplification();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "BranchSimplification"; }
+
+  virtual PassKind kind() { return PassKind::BRANCH_SIMPLIFICATION; }
+
+private:
+  void collectTargets(Bytecode *byte_code);
+  bool simplifyCondition(Bytecode *byte_code, Ins *branch);
+  bool simplifyLogical(Bytecode *byte_code, Ins *branch);
+  Ins *resolve(Bytecode *byte_code, Ins *ins, bool truthy);
+  void remove(Bytecode *byte_code, Ins *ins);
+  void retarget(Ins *branch, GroupOpcode group, Ins *target);
+
+  static bool isBoolean(Ins *ins);
+
+  /* instructions which are entered by a jump */
+  std::unordered_set<Ins *> targets_;
+};
+
+} // namespace optimizer
+
+#endif // BRANCH_SIMPLIFICATION_H
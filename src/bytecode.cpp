@@ -10,6 +10,7 @@
 #include "basic-block.h"
 #include "inst.h"
 #include "liveness-analysis.h"
+#include "loop-analysis.h"
 
 extern "C" {
 #include "jerry-snapshot.h"
@@ -45,13 +46,15 @@ void Bytecode::readSubFunctions(BytecodeList &list,
   for (uint32_t i = parent_byte_code->args().constLiteralEnd();
        i < parent_byte_code->args().literalEnd(); i++) {
     ecma_compiled_code_t *bytecode_literal_p = ECMA_GET_INTERNAL_VALUE_POINTER(
-        ecma_compiled_code_t,
-        parent_byte_code->literalPool().literalStart()[i]);
+        ecma_compiled_code_t, parent_byte_code->literalPool().at(i));
 
     if (bytecode_literal_p != parent_byte_code->compiledCode() &&
         CBC_IS_FUNCTION(bytecode_literal_p->status_flags)) {
-      Bytecode *sub_byte_code =
-          new Bytecode(bytecode_literal_p, parent_byte_code, i);
+      /* The index is relative to the literal pool start, so it remains valid
+         after the parent's registers are compacted */
+      Bytecode *sub_byte_code = new Bytecode(
+          bytecode_literal_p, parent_byte_code,
+          i - parent_byte_code->args().registerEnd());
       readSubFunctions(list, sub_byte_code);
       list.push_back(sub_byte_code);
     }
@@ -107,6 +110,58 @@ void Bytecode::setEncoding() {
   args_.setEncoding(limit, delta, one_byte_limit);
 }
 
+/**
+ * Select the literal encoding required by the current literal count
+ */
+void Bytecode::updateEncoding() {
+  if (args_.literalEnd() <= CBC_MAXIMUM_SMALL_VALUE) {
+    flags_.removeFlag(CBC_CODE_FLAGS_FULL_LITERAL_ENCODING);
+  } else {
+    flags_.addFlag(CBC_CODE_FLAGS_FULL_LITERAL_ENCODING);
+  }
+
+  setEncoding();
+}
+
+/**
+ * Select the smallest argument header which can hold the current counts
+ */
+void Bytecode::updateArgumentsFormat() {
+  if (args_.fitsU8args()) {
+    flags_.removeFlag(CBC_CODE_FLAGS_UINT16_ARGUMENTS);
+    args_.useU8args();
+  } else {
+    flags_.addFlag(CBC_CODE_FLAGS_UINT16_ARGUMENTS);
+    args_.useU16args();
+  }
+}
+
+/**
+ * End of the idents declared by CBC_DEFINE_VARS and CBC_INITIALIZE_VARS
+ *
+ * These opcodes declare every ident of their index range, so the idents
+ * before the returned index are addressed by their position.
+ */
+LiteralIndex Bytecode::declaredIdentEnd() {
+  LiteralIndex end = args_.registerEnd();
+
+  for (auto ins : instructions_) {
+    bool is_define = ins->opcode().is(CBC_DEFINE_VARS);
+
+    if (!is_define && !ins->opcode().is(CBC_INITIALIZE_VARS)) {
+      continue;
+    }
+
+    /* CBC_INITIALIZE_VARS starts with the first index of its range */
+    auto &literals = ins->argument().literals();
+    LiteralIndex last = literals[is_define ? 0 : 1].index();
+
+    end = std::max(end, static_cast<LiteralIndex>(last + 1));
+  }
+
+  return end;
+}
+
 void Bytecode::setBytecodeEnd() {
   size_t size = compiledCodesize();
   size_t end_info = 0;
@@ -130,6 +185,29 @@ void Bytecode::setBytecodeEnd() {
   byte_code_end_ =
       reinterpret_cast<uint8_t *>(compiledCode()) + size - end_info;
   end_info_ = end_info;
+  removed_end_info_ = 0;
+}
+
+/**
+ * The argument names are the last values of the end info, they are only
+ * needed by the mapped arguments object
+ */
+void Bytecode::removeMappedArguments() {
+  assert(flags().mappedArgumentsNeeded());
+
+  size_t names = args().argumentEnd() * sizeof(ecma_value_t);
+
+  flags_.removeFlag(CBC_CODE_FLAGS_MAPPED_ARGUMENTS_NEEDED);
+  end_info_ -= names;
+  removed_end_info_ += names;
+}
+
+/**
+ * Values stored after the byte code (function name, argument names, ...)
+ */
+std::vector<ecma_value_t> Bytecode::endInfoValues() {
+  auto end_info = reinterpret_cast<ecma_value_t *>(byte_code_end_);
+  return {end_info, end_info + end_info_ / sizeof(ecma_value_t)};
 }
 
 void Bytecode::decodeHeader() {
@@ -176,7 +254,151 @@ void Bytecode::buildInstructions() {
   LOG("--------- function intructions end --------");
 }
 
+void Bytecode::redirectOffsets(Ins *from, Ins *to) {
+  for (auto &iter : offset_to_ins_) {
+    if (iter.second == from) {
+      iter.second = to;
+    }
+  }
+}
+
+void Bytecode::replaceIns(Ins *ins, Ins *new_ins) {
+  auto iter = std::find(instructions_.begin(), instructions_.end(), ins);
+  assert(iter != instructions_.end());
+
+  new_ins->relocate(ins->offset());
+  new_ins->setBasicBlock(ins->bb());
+  *iter = new_ins;
+
+  if (ins->bb() != nullptr) {
+    auto &insns = ins->bb()->insns();
+    *std::find(insns.begin(), insns.end(), ins) = new_ins;
+  }
+
+  redirectOffsets(ins, new_ins);
+  delete ins;
+}
+
+/**
+ * The new instruction shares the offset of 'ins', so jumps keep
+ * targeting the first instruction of the sequence
+ */
+void Bytecode::insertInsAfter(Ins *ins, Ins *new_ins) {
+  auto iter = std::find(instructions_.begin(), instructions_.end(), ins);
+  assert(iter != instructions_.end());
+
+  new_ins->relocate(ins->offset());
+  new_ins->setBasicBlock(ins->bb());
+  instructions_.insert(std::next(iter), new_ins);
+
+  if (ins->bb() != nullptr) {
+    auto &insns = ins->bb()->insns();
+    insns.insert(std::next(std::find(insns.begin(), insns.end(), ins)),
+                 new_ins);
+  }
+}
+
+/**
+ * The new instruction takes over the offset of 'ins', so jumps to 'ins'
+ * continue with it
+ */
+void Bytecode::insertInsBefore(Ins *ins, Ins *new_ins) {
+  auto iter = std::find(instructions_.begin(), instructions_.end(), ins);
+  assert(iter != instructions_.end());
+
+  new_ins->relocate(ins->offset());
+  new_ins->setBasicBlock(ins->bb());
+  instructions_.insert(iter, new_ins);
+
+  if (ins->bb() != nullptr) {
+    auto &insns = ins->bb()->insns();
+    insns.insert(std::find(insns.begin(), insns.end(), ins), new_ins);
+  }
+
+  redirectOffsets(ins, new_ins);
+}
+
+/**
+ * Neighbours of 'ins' in the instruction list, nullptr at its ends
+ */
+Ins *Bytecode::previous(Ins *ins) {
+  auto iter = std::find(instructions_.begin(), instructions_.end(), ins);
+  assert(iter != instructions_.end());
+
+  return iter == instructions_.begin() ? nullptr : *std::prev(iter);
+}
+
+Ins *Bytecode::next(Ins *ins) {
+  auto iter = std::find(instructions_.begin(), instructions_.end(), ins);
+  assert(iter != instructions_.end());
+
+  return std::next(iter) == instructions_.end() ? nullptr : *std::next(iter);
+}
+
+/**
+ * Append a register, the literals behind the registers are shifted by one
+ */
+LiteralIndex Bytecode::addRegister() {
+  LiteralIndex reg = args().registerEnd();
+
+  for (auto ins : instructions()) {
+    for (auto &literal : ins->argument().literals()) {
+      if (literal.index() >= reg) {
+        literal.moveIndex(1);
+      }
+    }
+  }
+
+  args().moveRegIndex(1);
+  literalPool().movePoolStart(1);
+
+  return reg;
+}
+
+/**
+ * The constant is placed after the others, so the function and regexp
+ * literals move up by one. The sub functions are relocated by the caller.
+ */
+LiteralIndex Bytecode::addConstant(ecma_value_t value) {
+  LiteralIndex index = args().constLiteralEnd();
+
+  for (auto ins : instructions()) {
+    for (auto &literal : ins->argument().literals()) {
+      if (literal.index() >= index) {
+        literal.moveIndex(1);
+      }
+    }
+  }
+
+  auto &literals = literalPool().literals();
+  literals.insert(literals.begin() + (index - args().registerEnd()), value);
+  args().addConstants(1);
+
+  return index;
+}
+
+void Bytecode::removeIns(Ins *ins) {
+  auto iter = std::find(instructions_.begin(), instructions_.end(), ins);
+  assert(iter != instructions_.end());
+
+  /* jumps to the removed instruction continue with the following one */
+  auto next = std::next(iter);
+  redirectOffsets(ins, next != instructions_.end() ? *next : nullptr);
+  instructions_.erase(iter);
+
+  if (ins->bb() != nullptr) {
+    auto &insns = ins->bb()->insns();
+    insns.erase(std::find(insns.begin(), insns.end(), ins));
+  }
+
+  delete ins;
+}
+
 Bytecode::~Bytecode() {
+  for (auto loop : loops_) {
+    delete loop;
+  }
+
   for (auto iter : live_ranges_) {
     for (auto li : iter.second) {
       delete li;
@@ -205,20 +427,77 @@ void Bytecode::emitHeader(std::vector<uint8_t> &buffer) {
   if (flags_.uint16Arguments()) {
     cbc_uint16_arguments_t args = args_.toU16args();
     args.header = *compiled_code_;
+    args.header.status_flags = flags_.flags();
     memcpy(rbuffer, &args, sizeof(cbc_uint16_arguments_t));
   } else {
     cbc_uint8_arguments_t args = args_.toU8args();
     args.header = *compiled_code_;
+    args.header.status_flags = flags_.flags();
     memcpy(rbuffer, &args, sizeof(cbc_uint8_arguments_t));
   }
 
+  /* the literal pool follows the selected argument header */
   rbuffer += args_.size();
 
   /* write literal pool */
-  memcpy(rbuffer, literal_pool_.literalPoolStart(), lit_pool_size);
+  memcpy(rbuffer, literal_pool_.literals().data(), lit_pool_size);
+}
+
+/**
+ * Compute the final branch offsets
+ *
+ * Literal indices may have changed their encoded length, so every branch
+ * starts from the shortest offset form and is widened until the layout
+ * becomes stable.
+ */
+void Bytecode::relaxBranches() {
+  std::unordered_map<Ins *, Ins *> jump_targets;
+  std::unordered_map<Ins *, int32_t> offsets;
+
+  for (auto ins : instructions_) {
+    if (ins->argument().type() == OperandType::BRANCH) {
+      jump_targets[ins] =
+          insAt(ins->offset() + ins->argument().branchOffset());
+      ins->opcode().setBranchOffsetLength(1);
+    }
+  }
+
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+    int32_t offset = 0;
+
+    for (auto ins : instructions_) {
+      offsets[ins] = offset;
+      offset += static_cast<int32_t>(ins->encodedSize());
+    }
+
+    for (auto &iter : jump_targets) {
+      Ins *ins = iter.first;
+      int32_t branch_offset = offsets[iter.second] - offsets[ins];
+
+      assert((branch_offset < 0) ==
+             ins->opcode().opcodeData().isBackwardBrach());
+
+      uint32_t length = Argument::branchOffsetLength(branch_offset);
+
+      if (length > ins->opcode().branchOffsetLength()) {
+        ins->opcode().setBranchOffsetLength(length);
+        changed = true;
+      }
+    }
+  }
+
+  for (auto &iter : jump_targets) {
+    iter.first->argument().setBranchOffset(offsets[iter.second] -
+                                           offsets[iter.first]);
+  }
 }
 
 void Bytecode::emitInstructions(std::vector<uint8_t> &buffer) {
+  relaxBranches();
+
   for (auto &ins : instructions_) {
     /* write opcode */
     ins->emit(buffer);
@@ -231,6 +510,8 @@ void Bytecode::emitInstructions(std::vector<uint8_t> &buffer) {
 void Bytecode::emit() {
   std::vector<uint8_t> buffer;
 
+  updateEncoding();
+  updateArgumentsFormat();
   emitHeader(buffer);
   emitInstructions(buffer);
 
@@ -243,7 +524,7 @@ void Bytecode::emit() {
   if (end_info_ != 0) {
     memcpy(buffer.data() + total_size - end_info_,
            reinterpret_cast<uint8_t *>(compiled_code_) + compiledCodesize() -
-               end_info_,
+               removed_end_info_ - end_info_,
            end_info_);
   }
 
@@ -258,7 +539,7 @@ void Bytecode::emit() {
   if (parent_) {
     assert(parent_->flags().isFunction());
     ECMA_SET_INTERNAL_VALUE_POINTER(
-        parent_->literalPool().literalStart()[parent_literal_pool_index_],
+        parent_->literalPool().literals()[parent_literal_pool_index_],
         compiled_code_);
   } else {
     auto func = ecma_get_object_from_value(function_);
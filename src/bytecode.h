@@ -21,6 +21,7 @@ namespace optimizer {
 class Ins;
 class BasicBlock;
 class LiveInterval;
+class Loop;
 
 using RegList = std::vector<uint32_t>;
 using RegSet = std::unordered_set<uint32_t>;
@@ -38,6 +39,7 @@ using RegLiveInterval =
     std::pair<std::pair<uint32_t, uint32_t>, LiveInterval *>;
 using RegLiveIntervalList = std::vector<RegLiveInterval>;
 using LiveRangeMap = std::unordered_map<uint32_t, std::vector<LiveInterval *>>;
+using LoopList = std::vector<Loop *>;
 
 class BytecodeFlags {
 public:
@@ -45,6 +47,8 @@ public:
 
   auto flags() const { return flags_; }
   void setFlags(uint16_t flags) { flags_ = flags; }
+  void addFlag(uint16_t flag) { flags_ |= flag; }
+  void removeFlag(uint16_t flag) { flags_ &= static_cast<uint16_t>(~flag); }
 
   bool isFunction() const { return CBC_IS_FUNCTION(flags()) != 0; }
 
@@ -72,6 +76,12 @@ public:
     return (flags() & CBC_CODE_FLAGS_MAPPED_ARGUMENTS_NEEDED) != 0;
   }
 
+  bool lexicalEnvNotNeeded() const {
+    return (flags() & CBC_CODE_FLAGS_LEXICAL_ENV_NOT_NEEDED) != 0;
+  }
+
+  auto functionType() const { return CBC_FUNCTION_GET_TYPE(flags()); }
+
 private:
   uint16_t flags_;
 };
@@ -144,6 +154,20 @@ public:
     literal_end_ = static_cast<uint16_t>(literal_end_ + offset);
   }
 
+  void removeLiterals(uint16_t idents, uint16_t consts) {
+    ident_end_ = static_cast<uint16_t>(ident_end_ - idents);
+    const_literal_end_ =
+        static_cast<uint16_t>(const_literal_end_ - idents - consts);
+    literal_end_ = static_cast<uint16_t>(literal_end_ - idents - consts);
+  }
+
+  void addConstants(uint16_t consts) {
+    const_literal_end_ = static_cast<uint16_t>(const_literal_end_ + consts);
+    literal_end_ = static_cast<uint16_t>(literal_end_ + consts);
+  }
+
+  void setStackLimit(uint16_t limit) { stack_limit_ = limit; }
+
   void setEncoding(uint16_t limit, uint16_t delta, uint16_t one_byte_limit) {
     encoding_limit_ = limit;
     encoding_delta_ = delta;
@@ -152,6 +176,20 @@ public:
 
   auto literalCount() { return literal_end_ - register_end_; }
 
+  bool fitsU8args() const {
+    return std::max({argument_end_, register_end_, ident_end_,
+                     const_literal_end_, literal_end_,
+                     stack_limit_}) <= CBC_MAXIMUM_BYTE_VALUE;
+  }
+
+  void useU8args() {
+    size_ = static_cast<uint16_t>(sizeof(cbc_uint8_arguments_t));
+  }
+
+  void useU16args() {
+    size_ = static_cast<uint16_t>(sizeof(cbc_uint16_arguments_t));
+  }
+
   auto argumentEnd() const { return argument_end_; }
   auto registerEnd() const { return register_end_; }
   auto identEnd() const { return ident_end_; }
@@ -182,38 +220,37 @@ private:
 
 class LiteralPool {
 public:
-  LiteralPool() {}
+  LiteralPool() : register_end_(0) {}
 
-  auto literalPoolStart() const { return literal_pool_start_; }
-  auto literalStart() const { return literal_start_; }
-  auto end() const { return end_; }
-  auto size() const { return size_; }
+  auto &literals() { return literals_; }
+  auto registerEnd() const { return register_end_; }
+  auto end() const { return register_end_ + size(); }
+  size_t size() const { return literals_.size(); }
 
-  ValueRef getLiteral(LiteralIndex index) {
-    assert(index < end_);
-    return Value::_value(literalStart()[index]);
+  ecma_value_t &at(LiteralIndex index) {
+    assert(index >= register_end_ && index < end());
+    return literals_[index - register_end_];
   }
 
+  ValueRef getLiteral(LiteralIndex index) { return Value::_value(at(index)); }
+
   void movePoolStart(int32_t offset) {
-    end_ = static_cast<uint16_t>(end_ + offset);
+    register_end_ = static_cast<uint16_t>(register_end_ + offset);
   }
 
-  uint8_t *setLiteralPool(void *literalStart, BytecodeArguments &args) {
-    literal_pool_start_ = reinterpret_cast<ecma_value_t *>(literalStart);
-    literal_start_ = literal_pool_start_ - args.registerEnd();
-    end_ = args.literalEnd();
-    size_ = end_ - args.registerEnd();
+  uint8_t *setLiteralPool(void *literal_start, BytecodeArguments &args) {
+    auto literal_pool_start = reinterpret_cast<ecma_value_t *>(literal_start);
+    register_end_ = args.registerEnd();
+    literals_.assign(literal_pool_start,
+                     literal_pool_start + args.literalEnd() - register_end_);
 
     /* Bytecode start */
-    return reinterpret_cast<uint8_t *>(
-        reinterpret_cast<ecma_value_t *>(literalStart) + size_);
+    return reinterpret_cast<uint8_t *>(literal_pool_start + literals_.size());
   }
 
 private:
-  ecma_value_t *literal_pool_start_;
-  ecma_value_t *literal_start_;
-  uint16_t size_;
-  uint16_t end_;
+  std::vector<ecma_value_t> literals_;
+  uint16_t register_end_;
 };
 
 class Bytecode;
@@ -230,18 +267,34 @@ public:
   auto &args() { return args_; }
 
   auto function() const { return function_; }
+  auto parent() const { return parent_; }
+  auto parentLiteralPoolIndex() const { return parent_literal_pool_index_; }
+  void setParentLiteralPoolIndex(uint32_t index) {
+    parent_literal_pool_index_ = index;
+  }
   auto &byteCodeStart() const { return byte_code_start_; }
   auto &byteCodeCurrent() { return byte_code_; }
-  auto flags() const { return flags_; }
-  auto literalPool() const { return literal_pool_; }
+  auto &flags() { return flags_; }
+  auto &literalPool() { return literal_pool_; }
   auto &stack() { return stack_; }
   auto &instructions() { return instructions_; }
   auto &offsetToInst() { return offset_to_ins_; }
   auto &basicBlockList() { return bb_list_; }
 
   auto &liveRanges() { return live_ranges_; }
+  auto &loops() { return loops_; }
 
   Ins *insAt(int32_t offset) { return offsetToInst().find(offset)->second; }
+  LiteralIndex declaredIdentEnd();
+
+  void replaceIns(Ins *ins, Ins *new_ins);
+  void insertInsBefore(Ins *ins, Ins *new_ins);
+  void insertInsAfter(Ins *ins, Ins *new_ins);
+  Ins *previous(Ins *ins);
+  Ins *next(Ins *ins);
+  void removeIns(Ins *ins);
+  LiteralIndex addRegister();
+  LiteralIndex addConstant(ecma_value_t value);
 
   size_t compiledCodesize() const {
     return static_cast<size_t>(compiledCode()->size) << JMEM_ALIGNMENT_LOG;
@@ -250,7 +303,11 @@ public:
   void setArguments(cbc_uint16_arguments_t *args);
   void setArguments(cbc_uint8_arguments_t *args);
   void setEncoding();
+  void updateEncoding();
+  void updateArgumentsFormat();
   void setBytecodeEnd();
+  std::vector<ecma_value_t> endInfoValues();
+  void removeMappedArguments();
 
   uint32_t toRegisterIndex(LiteralIndex index) {
     return index; // - args().argumentEnd();
@@ -277,7 +334,9 @@ private:
   void buildInstructions();
 
   void emitHeader(std::vector<uint8_t> &buffer);
+  void relaxBranches();
   void emitInstructions(std::vector<uint8_t> &buffer);
+  void redirectOffsets(Ins *from, Ins *to);
 
   ecma_value_t function_;
   ecma_compiled_code_t *compiled_code_;
@@ -288,6 +347,8 @@ private:
   uint8_t *byte_code_start_;
   uint8_t *byte_code_end_;
   size_t end_info_;
+  /* end info at the end of the original byte code which is not emitted */
+  size_t removed_end_info_;
   BytecodeFlags flags_;
 
   BytecodeArguments args_;
@@ -299,6 +360,9 @@ private:
 
   // Live Ranges
   LiveRangeMap live_ranges_;
+
+  // LoopAnalysis
+  LoopList loops_;
 };
 
 } // namespace optimizer
@@ -0,0 +1,992 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "constant-propagation.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+ConstantValue ConstantValue::constant(ecma_value_t value) {
+  if (value == ECMA_VALUE_UNDEFINED || value == ECMA_VALUE_NULL ||
+      value == ECMA_VALUE_TRUE || value == ECMA_VALUE_FALSE ||
+      ecma_is_value_integer_number(value)) {
+    return ConstantValue(value);
+  }
+
+  return unknown();
+}
+
+ConstantValue ConstantValue::integer(int64_t value) {
+  if (value < ECMA_INTEGER_NUMBER_MIN || value > ECMA_INTEGER_NUMBER_MAX) {
+    return unknown();
+  }
+
+  return ConstantValue(ecma_make_integer_value(static_cast<int32_t>(value)));
+}
+
+bool ConstantValue::toBoolean() const {
+  assert(isKnown());
+
+  if (ecma_is_value_integer_number(value_)) {
+    return ecma_get_integer_from_value(value_) != 0;
+  }
+
+  return value_ == ECMA_VALUE_TRUE;
+}
+
+/**
+ * ToNumber of the value if it is an integer, undefined is NaN
+ */
+bool ConstantValue::toInteger(int32_t &result) const {
+  if (!isKnown() || value_ == ECMA_VALUE_UNDEFINED) {
+    return false;
+  }
+
+  if (ecma_is_value_integer_number(value_)) {
+    result = ecma_get_integer_from_value(value_);
+  } else {
+    result = value_ == ECMA_VALUE_TRUE ? 1 : 0;
+  }
+
+  return true;
+}
+
+bool ConstantState::meet(const ConstantState &other) {
+  bool changed = false;
+
+  for (size_t i = 0; i < registers.size(); i++) {
+    ConstantValue value = registers[i].meet(other.registers[i]);
+
+    if (value != registers[i]) {
+      registers[i] = value;
+      changed = true;
+    }
+  }
+
+  size_t size = std::min(stack.size(), other.stack.size());
+
+  if (size < stack.size()) {
+    stack.erase(stack.begin(), stack.begin() + (stack.size() - size));
+    changed = true;
+  }
+
+  size_t other_start = other.stack.size() - size;
+
+  for (size_t i = 0; i < size; i++) {
+    ConstantValue value = stack[i].meet(other.stack[other_start + i]);
+
+    if (value != stack[i]) {
+      stack[i] = value;
+      changed = true;
+    }
+  }
+
+  return changed;
+}
+
+ConstantPropagation::ConstantPropagation() : Pass() {}
+
+ConstantPropagation::~ConstantPropagation() {}
+
+bool ConstantPropagation::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::CONTROL_FLOW_ANALYSIS));
+
+  if (!prepare(byte_code)) {
+    LOG("Constant propagation skipped");
+    return true;
+  }
+
+  analyze(byte_code);
+  rewrite(byte_code);
+
+  return true;
+}
+
+/**
+ * Reset the analysis for a new function, false if it is not supported
+ */
+bool ConstantPropagation::prepare(Bytecode *byte_code) {
+  states_.clear();
+  worklist_.clear();
+  results_.clear();
+  conditions_.clear();
+  operands_.clear();
+
+  return isSupported(byte_code);
+}
+
+/**
+ * Execute a non-jump instruction on the abstract state
+ */
+void ConstantPropagation::evaluate(Bytecode *byte_code, Ins *ins,
+                                   ConstantState &state) {
+  assert(!ins->isJump());
+  transfer(byte_code, ins, state);
+}
+
+/**
+ * Contexts and branches outside of the control flow graph are not modeled
+ */
+bool ConstantPropagation::isSupported(Bytecode *byte_code) {
+  for (auto ins : byte_code->instructions()) {
+    if (ins->isTryContext() ||
+        (ins->argument().type() == OperandType::BRANCH && !ins->isJump())) {
+      return false;
+    }
+  }
+
+  registers_.analyze(byte_code);
+  return true;
+}
+
+void ConstantPropagation::analyze(Bytecode *byte_code) {
+  BasicBlockList &bbs = byte_code->basicBlockList();
+
+  ConstantState entry;
+  entry.registers.resize(byte_code->args().registerEnd());
+
+  for (auto succ : bbs[0]->successors()) {
+    propagate(succ, entry);
+  }
+
+  while (!worklist_.empty()) {
+    BasicBlock *bb = worklist_.back();
+    worklist_.pop_back();
+    visit(byte_code, bb);
+  }
+}
+
+void ConstantPropagation::propagate(BasicBlock *bb,
+                                    const ConstantState &state) {
+  if (!bb->isValid()) {
+    return;
+  }
+
+  auto iter = states_.find(bb);
+
+  if (iter == states_.end()) {
+    states_.insert({bb, state});
+  } else if (!iter->second.meet(state)) {
+    return;
+  }
+
+  if (std::find(worklist_.begin(), worklist_.end(), bb) == worklist_.end()) {
+    worklist_.push_back(bb);
+  }
+}
+
+void ConstantPropagation::visit(Bytecode *byte_code, BasicBlock *bb) {
+  ConstantState state = states_[bb];
+
+  for (auto ins : bb->insns()) {
+    if (ins->hasFlag(InstFlags::DEAD)) {
+      break;
+    }
+
+    if (ins->isJump()) {
+      branch(byte_code, bb, ins, state);
+      return;
+    }
+
+    transfer(byte_code, ins, state);
+
+    GroupOpcode group = ins->opcode().opcodeData().groupOpcode();
+
+    if (group == VM_OC_RETURN || group == VM_OC_THROW) {
+      return;
+    }
+  }
+
+  for (auto succ : bb->successors()) {
+    propagate(succ, state);
+  }
+}
+
+void ConstantPropagation::branch(Bytecode *byte_code, BasicBlock *bb,
+                                 Ins *ins, ConstantState &state) {
+  GroupOpcode group = ins->opcode().opcodeData().groupOpcode();
+  ConstantValue condition;
+  ConstantState taken;
+
+  switch (group) {
+  case VM_OC_JUMP: {
+    propagate(byte_code->insAt(ins->jumpTarget())->bb(), state);
+    return;
+  }
+  case VM_OC_BRANCH_IF_TRUE:
+  case VM_OC_BRANCH_IF_FALSE: {
+    condition = state.pop();
+    taken = state;
+    break;
+  }
+  case VM_OC_BRANCH_IF_LOGICAL_TRUE:
+  case VM_OC_BRANCH_IF_LOGICAL_FALSE: {
+    /* the value is kept only when the branch is taken */
+    condition = state.top();
+    taken = state;
+    state.pop();
+    break;
+  }
+  case VM_OC_BRANCH_IF_STRICT_EQUAL: {
+    /* the switch value is dropped only when the case matches */
+    ConstantValue value = state.pop();
+    ConstantValue top = state.top();
+
+    if (value.isKnown() && top.isKnown()) {
+      condition = ConstantValue::boolean(value == top);
+    }
+
+    taken = state;
+    taken.pop();
+    break;
+  }
+  default: {
+    state.stack.clear();
+
+    for (auto succ : bb->successors()) {
+      propagate(succ, state);
+    }
+    return;
+  }
+  }
+
+  BasicBlock *target = byte_code->insAt(ins->jumpTarget())->bb();
+  BasicBlock *next = fallthrough(bb, target);
+  conditions_[ins] = condition;
+
+  if (!condition.isKnown()) {
+    propagate(next, state);
+    propagate(target, taken);
+    return;
+  }
+
+  bool jumps = condition.toBoolean();
+
+  if (group == VM_OC_BRANCH_IF_FALSE ||
+      group == VM_OC_BRANCH_IF_LOGICAL_FALSE) {
+    jumps = !jumps;
+  }
+
+  if (jumps) {
+    propagate(target, taken);
+  } else {
+    propagate(next, state);
+  }
+}
+
+void ConstantPropagation::transfer(Bytecode *byte_code, Ins *ins,
+                                   ConstantState &state) {
+  OpcodeData data = ins->opcode().opcodeData();
+  GroupOpcode group = data.groupOpcode();
+
+  if (data.isPutReference()) {
+    clobber(byte_code, ins, state);
+    return;
+  }
+
+  switch (group) {
+  case VM_OC_POP: {
+    state.pop();
+    break;
+  }
+  case VM_OC_PUSH: {
+    ConstantValue value = read(byte_code, ins, 0, state);
+    results_[ins] = value;
+    state.push(value);
+    break;
+  }
+  case VM_OC_PUSH_TWO: {
+    if (data.operands() == OperandType::THIS_LITERAL) {
+      state.push(ConstantValue::unknown());
+      state.push(read(byte_code, ins, 0, state));
+    } else {
+      state.push(read(byte_code, ins, 0, state));
+      state.push(read(byte_code, ins, 1, state));
+    }
+    break;
+  }
+  case VM_OC_PUSH_THREE: {
+    for (size_t i = 0; i < 3; i++) {
+      state.push(read(byte_code, ins, i, state));
+    }
+    break;
+  }
+  case VM_OC_PUSH_UNDEFINED: {
+    state.push(ConstantValue::constant(ECMA_VALUE_UNDEFINED));
+    break;
+  }
+  case VM_OC_PUSH_TRUE: {
+    state.push(ConstantValue::boolean(true));
+    break;
+  }
+  case VM_OC_PUSH_FALSE: {
+    state.push(ConstantValue::boolean(false));
+    break;
+  }
+  case VM_OC_PUSH_NULL: {
+    state.push(ConstantValue::constant(ECMA_VALUE_NULL));
+    break;
+  }
+  case VM_OC_PUSH_0: {
+    state.push(ConstantValue::integer(0));
+    break;
+  }
+  case VM_OC_PUSH_POS_BYTE: {
+    state.push(ConstantValue::integer(ins->argument().byteArg() + 1));
+    break;
+  }
+  case VM_OC_PUSH_NEG_BYTE: {
+    state.push(ConstantValue::integer(-(ins->argument().byteArg() + 1)));
+    break;
+  }
+  case VM_OC_PUSH_LIT_0: {
+    state.push(read(byte_code, ins, 0, state));
+    state.push(ConstantValue::integer(0));
+    break;
+  }
+  case VM_OC_PUSH_LIT_POS_BYTE: {
+    state.push(read(byte_code, ins, 0, state));
+    state.push(ConstantValue::integer(ins->argument().byteArg() + 1));
+    break;
+  }
+  case VM_OC_PUSH_LIT_NEG_BYTE: {
+    state.push(read(byte_code, ins, 0, state));
+    state.push(ConstantValue::integer(-(ins->argument().byteArg() + 1)));
+    break;
+  }
+  case VM_OC_ASSIGN: {
+    ConstantValue value = data.operands() == OperandType::STACK
+                              ? state.pop()
+                              : read(byte_code, ins, 0, state);
+    putResult(byte_code, ins, value, state);
+    break;
+  }
+  case VM_OC_MOV_IDENT: {
+    write(byte_code, ins->argument().literals().back(), state.pop(), state);
+    break;
+  }
+  case VM_OC_PRE_INCR:
+  case VM_OC_PRE_DECR:
+  case VM_OC_POST_INCR:
+  case VM_OC_POST_DECR: {
+    if (!data.isPutIdent()) {
+      clobber(byte_code, ins, state);
+      break;
+    }
+
+    /* the operand is the destination as well, so it is not recorded */
+    Literal &literal = ins->argument().literals().back();
+    ConstantValue old_value;
+    ConstantValue new_value;
+    int32_t number;
+
+    if (literal.index() < byte_code->args().registerEnd() &&
+        state.registers[literal.index()].toInteger(number)) {
+      bool is_incr = group == VM_OC_PRE_INCR || group == VM_OC_POST_INCR;
+      old_value = ConstantValue::integer(number);
+      new_value = ConstantValue::integer(is_incr ? number + 1 : number - 1);
+    }
+
+    write(byte_code, literal, new_value, state);
+
+    if (data.isPutStack()) {
+      bool is_pre = group == VM_OC_PRE_INCR || group == VM_OC_PRE_DECR;
+      state.push(is_pre ? new_value : old_value);
+    }
+    break;
+  }
+  case VM_OC_NOT:
+  case VM_OC_PLUS:
+  case VM_OC_MINUS:
+  case VM_OC_BIT_NOT:
+  case VM_OC_VOID: {
+    ConstantValue value;
+
+    if (data.operands() == OperandType::STACK) {
+      value = state.pop();
+    } else if (data.operands() == OperandType::LITERAL) {
+      value = read(byte_code, ins, 0, state);
+    } else {
+      clobber(byte_code, ins, state);
+      break;
+    }
+
+    ConstantValue result = unary(group, value);
+    results_[ins] = result;
+    putResult(byte_code, ins, result, state);
+    break;
+  }
+  case VM_OC_BIT_OR:
+  case VM_OC_BIT_XOR:
+  case VM_OC_BIT_AND:
+  case VM_OC_EQUAL:
+  case VM_OC_NOT_EQUAL:
+  case VM_OC_STRICT_EQUAL:
+  case VM_OC_STRICT_NOT_EQUAL:
+  case VM_OC_LESS:
+  case VM_OC_GREATER:
+  case VM_OC_LESS_EQUAL:
+  case VM_OC_GREATER_EQUAL:
+  case VM_OC_IN:
+  case VM_OC_INSTANCEOF:
+  case VM_OC_LEFT_SHIFT:
+  case VM_OC_RIGHT_SHIFT:
+  case VM_OC_UNS_RIGHT_SHIFT:
+  case VM_OC_ADD:
+  case VM_OC_SUB:
+  case VM_OC_MUL:
+  case VM_OC_DIV:
+  case VM_OC_MOD:
+#if ENABLED(JERRY_ESNEXT)
+  case VM_OC_EXP:
+#endif /* ENABLED (JERRY_ESNEXT) */
+  {
+    ConstantValue left;
+    ConstantValue right;
+
+    switch (data.operands()) {
+    case OperandType::STACK_STACK: {
+      right = state.pop();
+      left = state.pop();
+      break;
+    }
+    case OperandType::STACK_LITERAL: {
+      left = state.pop();
+      right = read(byte_code, ins, 0, state);
+      break;
+    }
+    case OperandType::LITERAL_LITERAL: {
+      left = read(byte_code, ins, 0, state);
+      right = read(byte_code, ins, 1, state);
+      break;
+    }
+    default: {
+      clobber(byte_code, ins, state);
+      return;
+    }
+    }
+
+    ConstantValue result = binary(group, left, right);
+    results_[ins] = result;
+    putResult(byte_code, ins, result, state);
+    break;
+  }
+#if ENABLED(JERRY_LINE_INFO)
+  case VM_OC_LINE: {
+    break;
+  }
+#endif /* ENABLED (JERRY_LINE_INFO) */
+  default: {
+    clobber(byte_code, ins, state);
+    break;
+  }
+  }
+}
+
+/**
+ * Forget everything the instruction may have changed
+ */
+void ConstantPropagation::clobber(Bytecode *byte_code, Ins *ins,
+                                  ConstantState &state) {
+  state.stack.clear();
+
+  if (ins->hasFlag(InstFlags::WRITE_REG)) {
+    Literal literal(LiteralType::REGISTER,
+                    static_cast<LiteralIndex>(ins->writeReg()));
+    write(byte_code, literal, ConstantValue::unknown(), state);
+  }
+}
+
+ConstantValue ConstantPropagation::read(Bytecode *byte_code, Ins *ins,
+                                        size_t index, ConstantState &state) {
+  BytecodeArguments &args = byte_code->args();
+  LiteralIndex literal_index = ins->argument().literals()[index].index();
+  ConstantValue value;
+
+  if (literal_index < args.registerEnd()) {
+    value = state.registers[literal_index];
+  } else if (literal_index >= args.identEnd() &&
+             literal_index < args.constLiteralEnd()) {
+    value = ConstantValue::constant(
+        byte_code->literalPool().at(literal_index));
+  }
+
+  ConstantList &operands = operands_[ins];
+
+  if (operands.size() <= index) {
+    operands.resize(index + 1);
+  }
+
+  operands[index] = value;
+  return value;
+}
+
+void ConstantPropagation::write(Bytecode *byte_code, Literal &literal,
+                                ConstantValue value, ConstantState &state) {
+  if (literal.index() >= byte_code->args().registerEnd() ||
+      registers_.isUntracked(literal.index())) {
+    return;
+  }
+
+  state.registers[literal.index()] = value;
+}
+
+void ConstantPropagation::putResult(Bytecode *byte_code, Ins *ins,
+                                    ConstantValue value,
+                                    ConstantState &state) {
+  OpcodeData data = ins->opcode().opcodeData();
+
+  if (data.isPutIdent()) {
+    write(byte_code, ins->argument().literals().back(), value, state);
+  }
+
+  if (data.isPutStack()) {
+    state.push(value);
+  }
+}
+
+void ConstantPropagation::rewrite(Bytecode *byte_code) {
+  for (auto bb : byte_code->basicBlockList()) {
+    if (states_.find(bb) == states_.end()) {
+      continue;
+    }
+
+    InsList insns = bb->insns();
+
+    for (auto ins : insns) {
+      if (ins->hasFlag(InstFlags::DEAD)) {
+        break;
+      }
+
+      if (ins->isJump()) {
+        resolveBranch(byte_code, ins);
+        break;
+      }
+
+      if (!fold(byte_code, ins)) {
+        replaceUses(byte_code, ins);
+      }
+    }
+  }
+
+  removeUnreached(byte_code);
+}
+
+/**
+ * Replace a pure computation with a known result by the push of the result.
+ * The stack operands are popped, the producers are left to the peephole pass.
+ */
+bool ConstantPropagation::fold(Bytecode *byte_code, Ins *ins) {
+  auto iter = results_.find(ins);
+
+  if (iter == results_.end() || !iter->second.isKnown()) {
+    return false;
+  }
+
+  BytecodeArguments &args = byte_code->args();
+  OpcodeData data = ins->opcode().opcodeData();
+  auto &literals = ins->argument().literals();
+
+  if (data.groupOpcode() == VM_OC_PUSH) {
+    if (literals[0].index() >= args.registerEnd()) {
+      return false;
+    }
+  } else if (!data.isPutStack() || data.isPutIdent() || data.isPutBlock()) {
+    return false;
+  }
+
+  /* reading an identifier may throw */
+  for (auto &literal : literals) {
+    if (literal.index() >= args.registerEnd() &&
+        (literal.index() < args.identEnd() ||
+         literal.index() >= args.constLiteralEnd())) {
+      return false;
+    }
+  }
+
+  Ins *push = materialize(byte_code, iter->second);
+
+  if (push == nullptr) {
+    return false;
+  }
+
+  size_t pops = 0;
+
+  switch (data.operands()) {
+  case OperandType::STACK:
+  case OperandType::STACK_LITERAL: {
+    pops = 1;
+    break;
+  }
+  case OperandType::STACK_STACK: {
+    pops = 2;
+    break;
+  }
+  default: {
+    break;
+  }
+  }
+
+  LOG("Fold constant: " << *ins);
+
+  if (pops == 0) {
+    byte_code->replaceIns(ins, push);
+    return true;
+  }
+
+  Ins *last = Ins::create(byte_code, Opcode(CBC_POP), {});
+  byte_code->replaceIns(ins, last);
+
+  for (size_t i = 1; i < pops; i++) {
+    Ins *pop = Ins::create(byte_code, Opcode(CBC_POP), {});
+    byte_code->insertInsAfter(last, pop);
+    last = pop;
+  }
+
+  byte_code->insertInsAfter(last, push);
+  return true;
+}
+
+/**
+ * Replace a branch with a known condition by its stack effect and an
+ * unconditional jump if it is taken
+ */
+bool ConstantPropagation::resolveBranch(Bytecode *byte_code, Ins *ins) {
+  auto iter = conditions_.find(ins);
+
+  if (iter == conditions_.end() || !iter->second.isKnown()) {
+    return false;
+  }
+
+  GroupOpcode group = ins->opcode().opcodeData().groupOpcode();
+  BasicBlock *bb = ins->bb();
+  BasicBlock *target = byte_code->insAt(ins->jumpTarget())->bb();
+  BasicBlock *next = fallthrough(bb, target);
+  bool jumps = iter->second.toBoolean();
+  size_t pops = 1;
+
+  if (group == VM_OC_BRANCH_IF_FALSE ||
+      group == VM_OC_BRANCH_IF_LOGICAL_FALSE) {
+    jumps = !jumps;
+  }
+
+  if (group == VM_OC_BRANCH_IF_LOGICAL_TRUE ||
+      group == VM_OC_BRANCH_IF_LOGICAL_FALSE) {
+    pops = jumps ? 0 : 1;
+  } else if (group == VM_OC_BRANCH_IF_STRICT_EQUAL) {
+    pops = jumps ? 2 : 1;
+  }
+
+  InsList replacement;
+
+  for (size_t i = 0; i < pops; i++) {
+    replacement.push_back(Ins::create(byte_code, Opcode(CBC_POP), {}));
+  }
+
+  if (jumps) {
+    CBCOpcode opcode =
+        ins->jumpOffset() < 0 ? CBC_JUMP_BACKWARD : CBC_JUMP_FORWARD;
+    Ins *jump = Ins::create(byte_code, Opcode(opcode), {});
+    jump->argument().setBranchOffset(ins->jumpOffset());
+    replacement.push_back(jump);
+  }
+
+  LOG("Resolve branch: " << *ins << (jumps ? " taken" : " not taken"));
+
+  byte_code->replaceIns(ins, replacement[0]);
+
+  for (size_t i = 1; i < replacement.size(); i++) {
+    byte_code->insertInsAfter(replacement[i - 1], replacement[i]);
+  }
+
+  if (next != target) {
+    bb->removeSuccessor(jumps ? next->id() : target->id());
+  }
+
+  return true;
+}
+
+/**
+ * Read the value of a register from the literal pool when it is known
+ */
+void ConstantPropagation::replaceUses(Bytecode *byte_code, Ins *ins) {
+  auto iter = operands_.find(ins);
+
+  if (iter == operands_.end()) {
+    return;
+  }
+
+  auto &literals = ins->argument().literals();
+  bool changed = false;
+
+  for (size_t i = 0; i < iter->second.size(); i++) {
+    ConstantValue value = iter->second[i];
+    LiteralIndex index;
+
+    if (!value.isKnown() ||
+        literals[i].index() >= byte_code->args().registerEnd() ||
+        !findConstant(byte_code, value, index)) {
+      continue;
+    }
+
+    LOG("Replace register: " << literals[i].index() << " with literal: "
+                             << index << " in: " << *ins);
+    literals[i] = Literal(LiteralType::CONSTANT, index);
+    changed = true;
+  }
+
+  if (changed) {
+    ins->updateRegisters();
+  }
+}
+
+void ConstantPropagation::removeUnreached(Bytecode *byte_code) {
+  BasicBlockList &bbs = byte_code->basicBlockList();
+  BasicBlock *bb_end = bbs.back();
+
+  for (auto iter = bbs.begin(); iter != bbs.end();) {
+    BasicBlock *bb = *iter;
+
+    if (!bb->isValid() || states_.find(bb) != states_.end()) {
+      iter++;
+      continue;
+    }
+
+    LOG("Remove unreached BB: " << bb->id());
+
+    InsList insns = bb->insns();
+
+    for (auto ins : insns) {
+      byte_code->removeIns(ins);
+    }
+
+    bb->remove();
+    delete bb;
+    iter = bbs.erase(iter);
+  }
+
+  /* the last block leads to the end block, as built by the CFA */
+  if (bb_end->isInaccessible()) {
+    bbs[bbs.size() - 2]->addSuccessor(bb_end);
+  }
+}
+
+Ins *ConstantPropagation::materialize(Bytecode *byte_code,
+                                      ConstantValue value) {
+  ecma_value_t ecma_value = value.value();
+
+  switch (ecma_value) {
+  case ECMA_VALUE_UNDEFINED: {
+    return Ins::create(byte_code, Opcode(CBC_PUSH_UNDEFINED), {});
+  }
+  case ECMA_VALUE_NULL: {
+    return Ins::create(byte_code, Opcode(CBC_PUSH_NULL), {});
+  }
+  case ECMA_VALUE_TRUE: {
+    return Ins::create(byte_code, Opcode(CBC_PUSH_TRUE), {});
+  }
+  case ECMA_VALUE_FALSE: {
+    return Ins::create(byte_code, Opcode(CBC_PUSH_FALSE), {});
+  }
+  default: {
+    break;
+  }
+  }
+
+  int32_t number = ecma_get_integer_from_value(ecma_value);
+
+  if (number == 0) {
+    return Ins::create(byte_code, Opcode(CBC_PUSH_NUMBER_0), {});
+  }
+
+  if (number >= -(UINT8_MAX + 1) && number <= UINT8_MAX + 1) {
+    CBCOpcode opcode =
+        number > 0 ? CBC_PUSH_NUMBER_POS_BYTE : CBC_PUSH_NUMBER_NEG_BYTE;
+    Ins *ins = Ins::create(byte_code, Opcode(opcode), {});
+    ins->argument().setByteArg(static_cast<uint8_t>(std::abs(number) - 1));
+    return ins;
+  }
+
+  LiteralIndex index;
+
+  if (!findConstant(byte_code, value, index)) {
+    return nullptr;
+  }
+
+  return Ins::create(byte_code, Opcode(CBC_PUSH_LITERAL),
+                     {Literal(LiteralType::CONSTANT, index)});
+}
+
+bool ConstantPropagation::findConstant(Bytecode *byte_code,
+                                       ConstantValue value,
+                                       LiteralIndex &index) {
+  BytecodeArguments &args = byte_code->args();
+
+  for (LiteralIndex i = args.identEnd(); i < args.constLiteralEnd(); i++) {
+    if (byte_code->literalPool().at(i) == value.value()) {
+      index = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+BasicBlock *ConstantPropagation::fallthrough(BasicBlock *bb,
+                                             BasicBlock *target) {
+  for (auto succ : bb->successors()) {
+    if (succ != target) {
+      return succ;
+    }
+  }
+
+  return target;
+}
+
+ConstantValue ConstantPropagation::unary(GroupOpcode group,
+                                         ConstantValue value) {
+  if (group == VM_OC_VOID) {
+    return ConstantValue::constant(ECMA_VALUE_UNDEFINED);
+  }
+
+  if (!value.isKnown()) {
+    return ConstantValue::unknown();
+  }
+
+  if (group == VM_OC_NOT) {
+    return ConstantValue::boolean(!value.toBoolean());
+  }
+
+  int32_t number;
+
+  if (!value.toInteger(number)) {
+    return ConstantValue::unknown();
+  }
+
+  switch (group) {
+  case VM_OC_PLUS: {
+    return ConstantValue::integer(number);
+  }
+  case VM_OC_MINUS: {
+    /* -0 is not an integer value */
+    return number == 0 ? ConstantValue::unknown()
+                       : ConstantValue::integer(-static_cast<int64_t>(number));
+  }
+  case VM_OC_BIT_NOT: {
+    return ConstantValue::integer(~number);
+  }
+  default: {
+    return ConstantValue::unknown();
+  }
+  }
+}
+
+ConstantValue ConstantPropagation::binary(GroupOpcode group,
+                                          ConstantValue left,
+                                          ConstantValue right) {
+  if (!left.isKnown() || !right.isKnown()) {
+    return ConstantValue::unknown();
+  }
+
+  switch (group) {
+  case VM_OC_STRICT_EQUAL: {
+    return ConstantValue::boolean(left == right);
+  }
+  case VM_OC_STRICT_NOT_EQUAL: {
+    return ConstantValue::boolean(left != right);
+  }
+  case VM_OC_EQUAL:
+  case VM_OC_NOT_EQUAL: {
+    bool equal;
+
+    if (left.isNullish() || right.isNullish()) {
+      equal = left.isNullish() && right.isNullish();
+    } else {
+      int32_t left_number;
+      int32_t right_number;
+      left.toInteger(left_number);
+      right.toInteger(right_number);
+      equal = left_number == right_number;
+    }
+
+    return ConstantValue::boolean(group == VM_OC_EQUAL ? equal : !equal);
+  }
+  default: {
+    break;
+  }
+  }
+
+  int32_t left_number;
+  int32_t right_number;
+
+  if (!left.toInteger(left_number) || !right.toInteger(right_number)) {
+    return ConstantValue::unknown();
+  }
+
+  int64_t a = left_number;
+  int64_t b = right_number;
+  uint32_t shift = static_cast<uint32_t>(right_number) & 0x1f;
+
+  switch (group) {
+  case VM_OC_LESS: {
+    return ConstantValue::boolean(a < b);
+  }
+  case VM_OC_GREATER: {
+    return ConstantValue::boolean(a > b);
+  }
+  case VM_OC_LESS_EQUAL: {
+    return ConstantValue::boolean(a <= b);
+  }
+  case VM_OC_GREATER_EQUAL: {
+    return ConstantValue::boolean(a >= b);
+  }
+  case VM_OC_ADD: {
+    return ConstantValue::integer(a + b);
+  }
+  case VM_OC_SUB: {
+    return ConstantValue::integer(a - b);
+  }
+  case VM_OC_MUL: {
+    /* -0 is not an integer value */
+    if (a * b == 0 && (a < 0 || b < 0)) {
+      return ConstantValue::unknown();
+    }
+    return ConstantValue::integer(a * b);
+  }
+  case VM_OC_MOD: {
+    if (b == 0 || (a < 0 && a % b == 0)) {
+      return ConstantValue::unknown();
+    }
+    return ConstantValue::integer(a % b);
+  }
+  case VM_OC_BIT_OR: {
+    return ConstantValue::integer(left_number | right_number);
+  }
+  case VM_OC_BIT_XOR: {
+    return ConstantValue::integer(left_number ^ right_number);
+  }
+  case VM_OC_BIT_AND: {
+    return ConstantValue::integer(left_number & right_number);
+  }
+  case VM_OC_LEFT_SHIFT: {
+    return ConstantValue::integer(
+        static_cast<int32_t>(static_cast<uint32_t>(left_number) << shift));
+  }
+  case VM_OC_RIGHT_SHIFT: {
+    return ConstantValue::integer(left_number >> shift);
+  }
+  case VM_OC_UNS_RIGHT_SHIFT: {
+    return ConstantValue::integer(static_cast<uint32_t>(left_number) >> shift);
+  }
+  default: {
+    return ConstantValue::unknown();
+  }
+  }
+}
+
+} // namespace optimizer
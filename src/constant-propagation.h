@@ -0,0 +1,162 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef CONSTANT_PROPAGATION_H
+#define CONSTANT_PROPAGATION_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+#include "register-analysis.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+/**
+ * Lattice value of a register or a stack slot. Only primitives which are
+ * directly encoded in an ecma_value_t are tracked, everything else is unknown.
+ */
+class ConstantValue {
+public:
+  ConstantValue() : known_(false), value_(ECMA_VALUE_UNDEFINED) {}
+
+  static ConstantValue unknown() { return ConstantValue(); }
+  static ConstantValue constant(ecma_value_t value);
+  static ConstantValue integer(int64_t value);
+
+  static ConstantValue boolean(bool value) {
+    return ConstantValue(value ? ECMA_VALUE_TRUE : ECMA_VALUE_FALSE);
+  }
+
+  bool isKnown() const { return known_; }
+  auto value() const { return value_; }
+
+  bool isUndefined() const {
+    return known_ && value_ == ECMA_VALUE_UNDEFINED;
+  }
+
+  bool isNullish() const {
+    return known_ && (value_ == ECMA_VALUE_UNDEFINED ||
+                      value_ == ECMA_VALUE_NULL);
+  }
+
+  bool toBoolean() const;
+  bool toInteger(int32_t &result) const;
+
+  ConstantValue meet(const ConstantValue &other) const {
+    return *this == other ? *this : unknown();
+  }
+
+  bool operator==(const ConstantValue &other) const {
+    return known_ == other.known_ && (!known_ || value_ == other.value_);
+  }
+
+  bool operator!=(const ConstantValue &other) const {
+    return !(*this == other);
+  }
+
+private:
+  ConstantValue(ecma_value_t value) : known_(true), value_(value) {}
+
+  bool known_;
+  ecma_value_t value_;
+};
+
+using ConstantList = std::vector<ConstantValue>;
+
+/**
+ * Values of the registers and the stack at a program point. The stack is
+ * aligned to its top: the slots below the tracked ones are unknown.
+ */
+struct ConstantState {
+  ConstantList registers;
+  ConstantList stack;
+
+  bool meet(const ConstantState &other);
+
+  void push(ConstantValue value) { stack.push_back(value); }
+
+  ConstantValue pop() {
+    if (stack.empty()) {
+      return ConstantValue::unknown();
+    }
+
+    ConstantValue value = stack.back();
+    stack.pop_back();
+    return value;
+  }
+
+  ConstantValue top() const {
+    return stack.empty() ? ConstantValue::unknown() : stack.back();
+  }
+};
+
+class ConstantPropagation : public Pass {
+public:
+  ConstantPropagation();
+  ~ConstantPropagation();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "ConstantPropagation"; }
+
+  virtual PassKind kind() { return PassKind::CONSTANT_PROPAGATION; }
+
+  /* straight-line evaluation for other passes, after a successful prepare */
+  bool prepare(Bytecode *byte_code);
+  void evaluate(Bytecode *byte_code, Ins *ins, ConstantState &state);
+
+private:
+  bool isSupported(Bytecode *byte_code);
+  void analyze(Bytecode *byte_code);
+  void visit(Bytecode *byte_code, BasicBlock *bb);
+  void propagate(BasicBlock *bb, const ConstantState &state);
+  void branch(Bytecode *byte_code, BasicBlock *bb, Ins *ins,
+              ConstantState &state);
+  void transfer(Bytecode *byte_code, Ins *ins, ConstantState &state);
+  void clobber(Bytecode *byte_code, Ins *ins, ConstantState &state);
+
+  ConstantValue read(Bytecode *byte_code, Ins *ins, size_t index,
+                     ConstantState &state);
+  void write(Bytecode *byte_code, Literal &literal, ConstantValue value,
+             ConstantState &state);
+  void putResult(Bytecode *byte_code, Ins *ins, ConstantValue value,
+                 ConstantState &state);
+
+  void rewrite(Bytecode *byte_code);
+  bool fold(Bytecode *byte_code, Ins *ins);
+  bool resolveBranch(Bytecode *byte_code, Ins *ins);
+  void replaceUses(Bytecode *byte_code, Ins *ins);
+  void removeUnreached(Bytecode *byte_code);
+
+  Ins *materialize(Bytecode *byte_code, ConstantValue value);
+  static bool findConstant(Bytecode *byte_code, ConstantValue value,
+                           LiteralIndex &index);
+  static BasicBlock *fallthrough(BasicBlock *bb, BasicBlock *target);
+
+  static ConstantValue unary(GroupOpcode group, ConstantValue value);
+  static ConstantValue binary(GroupOpcode group, ConstantValue left,
+                              ConstantValue right);
+
+  std::unordered_map<BasicBlock *, ConstantState> states_;
+  BasicBlockList worklist_;
+  /* last computed value of the foldable instructions */
+  std::unordered_map<Ins *, ConstantValue> results_;
+  /* last computed condition of the branches */
+  std::unordered_map<Ins *, ConstantValue> conditions_;
+  /* last computed value of the read literal operands */
+  std::unordered_map<Ins *, ConstantList> operands_;
+  RegisterAnalysis registers_;
+};
+
+} // namespace optimizer
+
+#endif // CONSTANT_PROPAGATION_H
@@ -23,7 +23,7 @@ public:
   ~DominatorAnalysis();
 
   virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
-  bool dominatedBy(BasicBlock *who, BasicBlock *by);
+  static bool dominatedBy(BasicBlock *who, BasicBlock *by);
 
   virtual const char* name() {
     return "DominatorTree";
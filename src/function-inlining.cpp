@@ -0,0 +1,611 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "function-inlining.h"
+#include "liveness-analysis.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+namespace {
+
+/**
+ * Operations which take their operands from the stack or from literals and
+ * push their result
+ */
+bool isExpression(GroupOpcode group) {
+  switch (group) {
+  case VM_OC_EQUAL:
+  case VM_OC_NOT_EQUAL:
+  case VM_OC_STRICT_EQUAL:
+  case VM_OC_STRICT_NOT_EQUAL:
+  case VM_OC_LESS:
+  case VM_OC_GREATER:
+  case VM_OC_LESS_EQUAL:
+  case VM_OC_GREATER_EQUAL:
+  case VM_OC_NOT:
+  case VM_OC_TYPEOF:
+  case VM_OC_TYPEOF_IDENT:
+  case VM_OC_VOID:
+  case VM_OC_PLUS:
+  case VM_OC_MINUS:
+  case VM_OC_BIT_NOT:
+  case VM_OC_BIT_OR:
+  case VM_OC_BIT_XOR:
+  case VM_OC_BIT_AND:
+  case VM_OC_LEFT_SHIFT:
+  case VM_OC_RIGHT_SHIFT:
+  case VM_OC_UNS_RIGHT_SHIFT:
+  case VM_OC_ADD:
+  case VM_OC_SUB:
+  case VM_OC_MUL:
+  case VM_OC_DIV:
+  case VM_OC_MOD:
+#if ENABLED(JERRY_ESNEXT)
+  case VM_OC_EXP:
+#endif /* ENABLED (JERRY_ESNEXT) */
+  case VM_OC_PROP_GET: {
+    return true;
+  }
+  default: {
+    return false;
+  }
+  }
+}
+
+/**
+ * Instructions which behave the same in the caller's frame: no 'this',
+ * 'arguments', scope lookup or block result is involved
+ */
+bool isInlinable(Ins *ins) {
+  OpcodeData data = ins->opcode().opcodeData();
+  GroupOpcode group = data.groupOpcode();
+
+  if (data.operands() == OperandType::THIS_LITERAL || data.isPutBlock() ||
+      data.isPutReference()) {
+    return false;
+  }
+
+  switch (group) {
+  case VM_OC_POP:
+  case VM_OC_PUSH:
+  case VM_OC_PUSH_TWO:
+  case VM_OC_PUSH_THREE:
+  case VM_OC_PUSH_UNDEFINED:
+  case VM_OC_PUSH_TRUE:
+  case VM_OC_PUSH_FALSE:
+  case VM_OC_PUSH_NULL:
+  case VM_OC_PUSH_0:
+  case VM_OC_PUSH_POS_BYTE:
+  case VM_OC_PUSH_NEG_BYTE:
+  case VM_OC_PUSH_LIT_0:
+  case VM_OC_PUSH_LIT_POS_BYTE:
+  case VM_OC_PUSH_LIT_NEG_BYTE:
+  case VM_OC_MOV_IDENT:
+  case VM_OC_PRE_INCR:
+  case VM_OC_PRE_DECR:
+  case VM_OC_POST_INCR:
+  case VM_OC_POST_DECR: {
+    return true;
+  }
+  case VM_OC_ASSIGN: {
+    return data.isPutIdent();
+  }
+  case VM_OC_RETURN: {
+    return !ins->opcode().isExtOpcode();
+  }
+  default: {
+    return isExpression(group);
+  }
+  }
+}
+
+bool isDirectCall(Ins *ins) {
+  CBCOpcode opcode = ins->opcode().CBCopcode();
+
+  /* each call kind has a plain, a push result and a block variant, followed
+     by the same three for property calls */
+  return !ins->opcode().isExtOpcode() &&
+         ins->opcode().opcodeData().groupOpcode() == VM_OC_CALL &&
+         (opcode - CBC_CALL) % 6 < 3;
+}
+
+bool findConstant(Bytecode *byte_code, ecma_value_t value,
+                  LiteralIndex &index) {
+  BytecodeArguments &args = byte_code->args();
+
+  for (LiteralIndex i = args.identEnd(); i < args.constLiteralEnd(); i++) {
+    if (byte_code->literalPool().at(i) == value) {
+      index = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace
+
+FunctionInlining::FunctionInlining() : Pass() {}
+
+FunctionInlining::~FunctionInlining() {}
+
+bool FunctionInlining::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::CONTROL_FLOW_ANALYSIS));
+
+  InsList calls;
+
+  for (auto ins : byte_code->instructions()) {
+    if (isDirectCall(ins)) {
+      calls.push_back(ins);
+    }
+  }
+
+  for (auto call : calls) {
+    inlineCall(optimizer, byte_code, call);
+  }
+
+  return true;
+}
+
+/**
+ * Replace a call of a local function declaration with the body of the
+ * function. The arguments are moved into fresh registers, the return value
+ * is left where the call would put it.
+ */
+bool FunctionInlining::inlineCall(Optimizer *optimizer, Bytecode *byte_code,
+                                  Ins *call) {
+  uint32_t argc = argumentCount(call);
+  Ins *push = findFunction(byte_code, call, argc);
+
+  if (push == nullptr) {
+    return false;
+  }
+
+  LiteralIndex function = push->argument().literals().front().index();
+  Bytecode *callee = boundFunction(optimizer, byte_code, function, call);
+  InsList body;
+
+  if (callee == nullptr || !collectBody(callee, body) ||
+      !hasConstants(byte_code, callee, body)) {
+    return false;
+  }
+
+  LOG("Inline call: " << *call);
+
+  BytecodeArguments &callee_args = callee->args();
+  LiteralIndex argument_end = callee_args.argumentEnd();
+
+  /* literals above the registers are shifted, the constants are mapped after
+     the registers are allocated */
+  registers_.clear();
+
+  for (LiteralIndex i = 0; i < callee_args.registerEnd(); i++) {
+    registers_.push_back(byte_code->addRegister());
+  }
+
+  InsList code;
+
+  /* the last argument is on the top of the stack */
+  for (uint32_t i = argc; i-- > 0;) {
+    if (i < argument_end) {
+      code.push_back(
+          Ins::create(byte_code, Opcode(CBC_ASSIGN_SET_IDENT),
+                      {Literal(LiteralType::REGISTER, registers_[i])}));
+    } else {
+      code.push_back(Ins::create(byte_code, Opcode(CBC_POP), {}));
+    }
+  }
+
+  /* registers of missing arguments and the registers which are read before
+     they are written start as undefined */
+  std::unordered_set<LiteralIndex> defined;
+
+  for (LiteralIndex i = 0; i < std::min<LiteralIndex>(argc, argument_end);
+       i++) {
+    defined.insert(i);
+  }
+
+  std::vector<LiteralIndex> undefined;
+
+  for (LiteralIndex i = argc; i < argument_end; i++) {
+    undefined.push_back(i);
+    defined.insert(i);
+  }
+
+  for (auto ins : body) {
+    /* the destination of a decoded write is also listed as read */
+    for (auto reg : LivenessAnalysis::uses(ins)) {
+      if (defined.insert(reg).second) {
+        undefined.push_back(reg);
+      }
+    }
+
+    if (ins->hasFlag(InstFlags::WRITE_REG)) {
+      defined.insert(ins->writeReg());
+    }
+  }
+
+  for (auto reg : undefined) {
+    code.push_back(Ins::create(byte_code, Opcode(CBC_PUSH_UNDEFINED), {}));
+    code.push_back(
+        Ins::create(byte_code, Opcode(CBC_ASSIGN_SET_IDENT),
+                    {Literal(LiteralType::REGISTER, registers_[reg])}));
+  }
+
+  Ins *ret = body.back();
+  body.pop_back();
+
+  for (auto ins : body) {
+    Ins *copy = Ins::create(byte_code, ins->opcode(),
+                            mapLiterals(byte_code, callee, ins));
+
+    if (ins->argument().hasByteArg()) {
+      copy->argument().setByteArg(ins->argument().byteArg());
+    }
+
+    code.push_back(copy);
+  }
+
+  if (ret->opcode().CBCopcode() == CBC_RETURN_WITH_LITERAL) {
+    code.push_back(Ins::create(byte_code, Opcode(CBC_PUSH_LITERAL),
+                               mapLiterals(byte_code, callee, ret)));
+  } else if (ret->opcode().CBCopcode() == CBC_RETURN_WITH_BLOCK) {
+    /* functions have no completion value */
+    code.push_back(Ins::create(byte_code, Opcode(CBC_PUSH_UNDEFINED), {}));
+  }
+
+  OpcodeData data = call->opcode().opcodeData();
+
+  if (data.isPutBlock()) {
+    code.push_back(Ins::create(byte_code, Opcode(CBC_POP_BLOCK), {}));
+  } else if (!data.isPutStack()) {
+    code.push_back(Ins::create(byte_code, Opcode(CBC_POP), {}));
+  }
+
+  removeFunction(byte_code, push);
+
+  Ins *anchor = call;
+
+  for (auto ins : code) {
+    byte_code->insertInsAfter(anchor, ins);
+    anchor = ins;
+  }
+
+  byte_code->removeIns(call);
+
+  /* the callee's stack is placed above the values of the caller */
+  byte_code->args().setStackLimit(static_cast<uint16_t>(
+      byte_code->args().stackLimit() + callee_args.stackLimit()));
+
+  return true;
+}
+
+/**
+ * The instruction in the block of the call which pushes the function object
+ * from a register
+ */
+Ins *FunctionInlining::findFunction(Bytecode *byte_code, Ins *call,
+                                    uint32_t argc) {
+  if (call->bb() == nullptr) {
+    return nullptr;
+  }
+
+  InsList &insns = call->bb()->insns();
+  auto iter = std::find(insns.begin(), insns.end(), call);
+  uint32_t needed = argc + 1;
+
+  while (iter != insns.begin()) {
+    Ins *ins = *--iter;
+    uint32_t pushes;
+    uint32_t pops;
+
+    if (ins->isJump() || !stackEffect(ins, pushes, pops)) {
+      return nullptr;
+    }
+
+    if (pushes < needed) {
+      needed = needed - pushes + pops;
+      continue;
+    }
+
+    /* the function object must be the first value pushed by 'ins' */
+    if (pushes != needed || pops != 0 || ins->argument().literals().empty() ||
+        ins->opcode().opcodeData().operands() == OperandType::THIS_LITERAL ||
+        ins->argument().literals().front().index() >=
+            byte_code->args().registerEnd()) {
+      return nullptr;
+    }
+
+    return ins;
+  }
+
+  return nullptr;
+}
+
+/**
+ * The function literal stored into 'reg' by the single function declaration
+ * of the entry block, which is run before 'call'
+ */
+Bytecode *FunctionInlining::boundFunction(Optimizer *optimizer,
+                                          Bytecode *byte_code,
+                                          LiteralIndex reg, Ins *call) {
+  BytecodeArguments &args = byte_code->args();
+  BasicBlockList &bbs = byte_code->basicBlockList();
+
+  if (reg < args.argumentEnd() || bbs.front()->successors().empty()) {
+    return nullptr;
+  }
+
+  InsList &insns = byte_code->instructions();
+  Ins *init = nullptr;
+
+  for (auto ins : insns) {
+    GroupOpcode group = ins->opcode().opcodeData().groupOpcode();
+    auto &literals = ins->argument().literals();
+
+    if (group == VM_OC_INIT_ARG_OR_FUNC && !literals.empty() &&
+        literals.front().index() == reg) {
+      if (init != nullptr) {
+        return nullptr;
+      }
+
+      init = ins;
+      continue;
+    }
+
+    if (ins->hasFlag(InstFlags::WRITE_REG) && ins->writeReg() == reg) {
+      return nullptr;
+    }
+
+    /* references allow writes which are not tracked */
+    if (group == VM_OC_IDENT_REFERENCE) {
+      for (auto &literal : literals) {
+        if (literal.index() == reg) {
+          return nullptr;
+        }
+      }
+    }
+  }
+
+  if (init == nullptr || init->bb() != bbs.front()->successors().front() ||
+      (call->bb() == init->bb() &&
+       std::find(insns.begin(), insns.end(), call) <
+           std::find(insns.begin(), insns.end(), init))) {
+    return nullptr;
+  }
+
+  LiteralIndex function = init->argument().literals().back().index();
+
+  if (function < args.constLiteralEnd()) {
+    return nullptr;
+  }
+
+  for (auto candidate : optimizer->list()) {
+    if (candidate->parent() == byte_code &&
+        args.registerEnd() + candidate->parentLiteralPoolIndex() ==
+            function) {
+      return candidate;
+    }
+  }
+
+  return nullptr;
+}
+
+/**
+ * Straight-line callee code up to and including its first return
+ */
+bool FunctionInlining::collectBody(Bytecode *callee, InsList &body) {
+  BytecodeFlags &flags = callee->flags();
+
+  if (!flags.isFunction() || flags.mappedArgumentsNeeded() ||
+      !flags.lexicalEnvNotNeeded() || flags.hasTaggedTemplateLiterals() ||
+      (flags.functionType() != CBC_FUNCTION_NORMAL &&
+       flags.functionType() != CBC_FUNCTION_ARROW)) {
+    return false;
+  }
+
+  bool returns = false;
+
+  for (auto ins : callee->instructions()) {
+    /* without branches the code after the return is unreachable */
+    if (ins->argument().type() == OperandType::BRANCH) {
+      return false;
+    }
+
+    if (returns || ins->opcode().isExt(CBC_EXT_LINE)) {
+      continue;
+    }
+
+    if (!isInlinable(ins)) {
+      return false;
+    }
+
+    body.push_back(ins);
+    returns = ins->opcode().opcodeData().groupOpcode() == VM_OC_RETURN;
+  }
+
+  return returns && body.size() <= FUNCTION_INLINING_MAX_SIZE + 1;
+}
+
+/**
+ * The callee may only refer to its registers and to constants which are also
+ * present in the caller
+ */
+bool FunctionInlining::hasConstants(Bytecode *byte_code, Bytecode *callee,
+                                    InsList &body) {
+  BytecodeArguments &args = callee->args();
+
+  for (auto ins : body) {
+    for (auto &literal : ins->argument().literals()) {
+      LiteralIndex index = literal.index();
+      LiteralIndex constant;
+
+      if (index < args.registerEnd()) {
+        continue;
+      }
+
+      if (index < args.identEnd() || index >= args.constLiteralEnd() ||
+          !findConstant(byte_code, callee->literalPool().at(index),
+                        constant)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+std::vector<Literal> FunctionInlining::mapLiterals(Bytecode *byte_code,
+                                                   Bytecode *callee,
+                                                   Ins *ins) {
+  std::vector<Literal> literals;
+
+  for (auto &literal : ins->argument().literals()) {
+    LiteralIndex index = literal.index();
+
+    if (index < callee->args().registerEnd()) {
+      literals.push_back(Literal(LiteralType::REGISTER, registers_[index]));
+      continue;
+    }
+
+    LiteralIndex constant = 0;
+    bool found =
+        findConstant(byte_code, callee->literalPool().at(index), constant);
+    assert(found);
+    (void)found;
+
+    literals.push_back(Literal(LiteralType::CONSTANT, constant));
+  }
+
+  return literals;
+}
+
+/**
+ * Drop the function object from the instruction which pushes it
+ */
+void FunctionInlining::removeFunction(Bytecode *byte_code, Ins *push) {
+  auto &literals = push->argument().literals();
+  Ins *rest;
+
+  switch (push->opcode().opcodeData().groupOpcode()) {
+  case VM_OC_PUSH: {
+    byte_code->removeIns(push);
+    return;
+  }
+  case VM_OC_PUSH_TWO: {
+    rest = Ins::create(byte_code, Opcode(CBC_PUSH_LITERAL), {literals[1]});
+    break;
+  }
+  case VM_OC_PUSH_THREE: {
+    rest = Ins::create(byte_code, Opcode(CBC_PUSH_TWO_LITERALS),
+                       {literals[1], literals[2]});
+    break;
+  }
+  case VM_OC_PUSH_LIT_0: {
+    rest = Ins::create(byte_code, Opcode(CBC_PUSH_NUMBER_0), {});
+    break;
+  }
+  case VM_OC_PUSH_LIT_POS_BYTE: {
+    rest = Ins::create(byte_code, Opcode(CBC_PUSH_NUMBER_POS_BYTE), {});
+    rest->argument().setByteArg(push->argument().byteArg());
+    break;
+  }
+  default: {
+    assert(push->opcode().opcodeData().groupOpcode() ==
+           VM_OC_PUSH_LIT_NEG_BYTE);
+    rest = Ins::create(byte_code, Opcode(CBC_PUSH_NUMBER_NEG_BYTE), {});
+    rest->argument().setByteArg(push->argument().byteArg());
+    break;
+  }
+  }
+
+  byte_code->replaceIns(push, rest);
+}
+
+/**
+ * Number of values popped and pushed by the instructions which may compute
+ * the arguments of a call
+ */
+bool FunctionInlining::stackEffect(Ins *ins, uint32_t &pushes,
+                                   uint32_t &pops) {
+  OpcodeData data = ins->opcode().opcodeData();
+  GroupOpcode group = data.groupOpcode();
+
+  pops = 0;
+
+  switch (group) {
+  case VM_OC_PUSH:
+  case VM_OC_PUSH_UNDEFINED:
+  case VM_OC_PUSH_TRUE:
+  case VM_OC_PUSH_FALSE:
+  case VM_OC_PUSH_NULL:
+  case VM_OC_PUSH_THIS:
+  case VM_OC_PUSH_0:
+  case VM_OC_PUSH_POS_BYTE:
+  case VM_OC_PUSH_NEG_BYTE: {
+    pushes = 1;
+    return true;
+  }
+  case VM_OC_PUSH_TWO:
+  case VM_OC_PUSH_LIT_0:
+  case VM_OC_PUSH_LIT_POS_BYTE:
+  case VM_OC_PUSH_LIT_NEG_BYTE: {
+    pushes = 2;
+    return true;
+  }
+  case VM_OC_PUSH_THREE: {
+    pushes = 3;
+    return true;
+  }
+  default: {
+    break;
+  }
+  }
+
+  if (ins->opcode().isExtOpcode() || !isExpression(group) ||
+      data.isPutBlock() || data.isPutIdent()) {
+    return false;
+  }
+
+  switch (data.operands()) {
+  case OperandType::STACK:
+  case OperandType::STACK_LITERAL: {
+    pops = 1;
+    break;
+  }
+  case OperandType::STACK_STACK: {
+    pops = 2;
+    break;
+  }
+  case OperandType::NONE:
+  case OperandType::LITERAL:
+  case OperandType::LITERAL_LITERAL:
+  case OperandType::THIS_LITERAL: {
+    break;
+  }
+  default: {
+    return false;
+  }
+  }
+
+  pushes = data.isPutStack() ? 1 : 0;
+  return true;
+}
+
+uint32_t FunctionInlining::argumentCount(Ins *call) {
+  CBCOpcode opcode = call->opcode().CBCopcode();
+
+  if (opcode >= CBC_CALL0) {
+    return static_cast<uint32_t>((opcode - CBC_CALL0) / 6);
+  }
+
+  return call->argument().byteArg();
+}
+
+} // namespace optimizer
@@ -0,0 +1,58 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef FUNCTION_INLINING_H
+#define FUNCTION_INLINING_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+/* Largest callee body, without its return, which is inlined */
+#ifndef FUNCTION_INLINING_MAX_SIZE
+#define FUNCTION_INLINING_MAX_SIZE 16
+#endif /* !FUNCTION_INLINING_MAX_SIZE */
+
+class FunctionInlining : public Pass {
+public:
+  FunctionInlining();
+  ~FunctionInlining();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "FunctionInlining"; }
+
+  virtual PassKind kind() { return PassKind::FUNCTION_INLINING; }
+
+private:
+  bool inlineCall(Optimizer *optimizer, Bytecode *byte_code, Ins *call);
+  Ins *findFunction(Bytecode *byte_code, Ins *call, uint32_t argc);
+  Bytecode *boundFunction(Optimizer *optimizer, Bytecode *byte_code,
+                          LiteralIndex reg, Ins *call);
+  bool collectBody(Bytecode *callee, InsList &body);
+  bool hasConstants(Bytecode *byte_code, Bytecode *callee, InsList &body);
+  std::vector<Literal> mapLiterals(Bytecode *byte_code, Bytecode *callee,
+                                   Ins *ins);
+  void removeFunction(Bytecode *byte_code, Ins *push);
+
+  static bool stackEffect(Ins *ins, uint32_t &pushes, uint32_t &pops);
+  static uint32_t argumentCount(Ins *call);
+
+  /* caller registers of the callee's arguments and registers */
+  std::vector<LiteralIndex> registers_;
+};
+
+} // namespace optimizer
+
+#endif // FUNCTION_INLINING_H
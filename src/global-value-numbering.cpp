@@ -0,0 +1,214 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "global-value-numbering.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+namespace {
+
+bool isCommutative(GroupOpcode group) {
+  switch (group) {
+  case VM_OC_EQUAL:
+  case VM_OC_NOT_EQUAL:
+  case VM_OC_STRICT_EQUAL:
+  case VM_OC_STRICT_NOT_EQUAL:
+  case VM_OC_BIT_OR:
+  case VM_OC_BIT_XOR:
+  case VM_OC_BIT_AND:
+  case VM_OC_MUL: {
+    return true;
+  }
+  default: {
+    return false;
+  }
+  }
+}
+
+} // namespace
+
+GlobalValueNumbering::GlobalValueNumbering() : Pass() {}
+
+GlobalValueNumbering::~GlobalValueNumbering() {}
+
+bool GlobalValueNumbering::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::DOMINATOR_ANALYSIS));
+
+  children_.clear();
+  table_.clear();
+  available_.clear();
+
+  BasicBlockList &bbs = byte_code->basicBlockList();
+
+  for (auto bb : bbs) {
+    if (bb->idom() != nullptr) {
+      children_[bb->idom()].push_back(bb);
+    }
+  }
+
+  registers_.analyze(byte_code);
+  visit(byte_code, bbs[0]);
+
+  return true;
+}
+
+/**
+ * Walk the dominator tree, the values computed by a block are available in
+ * the blocks it dominates
+ */
+void GlobalValueNumbering::visit(Bytecode *byte_code, BasicBlock *bb) {
+  std::vector<ValueKey> keys;
+  RegList defs;
+  InsList insns = bb->insns();
+
+  for (auto ins : insns) {
+    if (ins->hasFlag(InstFlags::DEAD)) {
+      break;
+    }
+
+    ValueKey key;
+
+    if (valueKey(byte_code, ins, key)) {
+      auto iter = table_.find(key);
+
+      if (iter != table_.end()) {
+        LiteralIndex reg = holder(byte_code, iter->second);
+
+        LOG("Redundant: " << *ins << " reuses register: " << reg);
+
+        byte_code->replaceIns(
+            ins, Ins::create(byte_code, Opcode(CBC_PUSH_LITERAL),
+                             {Literal(LiteralType::REGISTER, reg)}));
+        continue;
+      }
+
+      table_.insert({key, {ins, GVN_NO_HOLDER}});
+      keys.push_back(key);
+    }
+
+    if (ins->hasFlag(InstFlags::WRITE_REG) &&
+        registers_.isStable(ins->writeReg()) &&
+        available_.insert(ins->writeReg()).second) {
+      defs.push_back(ins->writeReg());
+    }
+  }
+
+  for (auto child : children_[bb]) {
+    visit(byte_code, child);
+  }
+
+  for (auto &key : keys) {
+    table_.erase(key);
+  }
+
+  for (auto reg : defs) {
+    available_.erase(reg);
+  }
+}
+
+bool GlobalValueNumbering::valueKey(Bytecode *byte_code, Ins *ins,
+                                    ValueKey &key) {
+  BytecodeArguments &args = byte_code->args();
+  OpcodeData data = ins->opcode().opcodeData();
+  GroupOpcode group = data.groupOpcode();
+
+  if (!RegisterAnalysis::isPrimitiveResult(group) || group == VM_OC_IN ||
+      group == VM_OC_INSTANCEOF || !data.isPutStack() || data.isPutIdent() ||
+      data.isPutBlock() || data.isPutReference()) {
+    return false;
+  }
+
+  if (data.operands() != OperandType::LITERAL &&
+      data.operands() != OperandType::LITERAL_LITERAL &&
+      group != VM_OC_TYPEOF_IDENT) {
+    return false;
+  }
+
+  std::vector<uint64_t> numbers;
+
+  for (auto &literal : ins->argument().literals()) {
+    LiteralIndex index = literal.index();
+
+    if (index < args.registerEnd()) {
+      if (!isAvailable(index)) {
+        return false;
+      }
+
+      numbers.push_back(index);
+    } else if (index >= args.identEnd() && index < args.constLiteralEnd()) {
+      numbers.push_back((static_cast<uint64_t>(1) << 32) |
+                        byte_code->literalPool().at(index));
+    } else {
+      return false;
+    }
+
+    /* conversions of objects may call user code */
+    if (!RegisterAnalysis::isAlwaysPure(group) &&
+        registers_.kind(byte_code, literal) < ValueKind::PRIMITIVE) {
+      return false;
+    }
+  }
+
+  if (isCommutative(group)) {
+    std::sort(numbers.begin(), numbers.end());
+  }
+
+  key = {ins->opcode().CBCopcode(), numbers};
+  return true;
+}
+
+/**
+ * The register has the same value at every read the current one dominates
+ */
+bool GlobalValueNumbering::isAvailable(LiteralIndex reg) {
+  if (!registers_.isStable(reg)) {
+    return false;
+  }
+
+  return registers_.writeCount(reg) == 0 ||
+         available_.find(reg) != available_.end();
+}
+
+/**
+ * Register which keeps the result of 'ins'. A single write right after the
+ * computation is reused, otherwise the result is stored into a new register.
+ */
+LiteralIndex GlobalValueNumbering::holder(Bytecode *byte_code,
+                                          ValueEntry &entry) {
+  if (entry.holder != GVN_NO_HOLDER) {
+    return entry.holder;
+  }
+
+  Ins *ins = entry.ins;
+  Ins *store = byte_code->next(ins);
+
+  if (store != nullptr && store->bb() == ins->bb() &&
+      !store->hasFlag(InstFlags::DEAD) &&
+      store->hasFlag(InstFlags::WRITE_REG) &&
+      registers_.isStable(store->writeReg())) {
+    OpcodeData data = store->opcode().opcodeData();
+
+    if (data.groupOpcode() == VM_OC_MOV_IDENT ||
+        (data.groupOpcode() == VM_OC_ASSIGN &&
+         data.operands() == OperandType::STACK)) {
+      entry.holder = static_cast<LiteralIndex>(store->writeReg());
+      return entry.holder;
+    }
+  }
+
+  entry.holder = byte_code->addRegister();
+  LOG("Keep: " << *ins << " in register: " << entry.holder);
+
+  byte_code->insertInsAfter(
+      ins, Ins::create(byte_code, Opcode(CBC_ASSIGN_SET_IDENT_PUSH_RESULT),
+                       {Literal(LiteralType::REGISTER, entry.holder)}));
+  return entry.holder;
+}
+
+} // namespace optimizer
@@ -0,0 +1,63 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef GLOBAL_VALUE_NUMBERING_H
+#define GLOBAL_VALUE_NUMBERING_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+#include "register-analysis.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+#define GVN_NO_HOLDER UINT16_MAX
+
+/**
+ * Opcode and the value numbers of its literal operands. A register is
+ * numbered by its index, a constant by its value.
+ */
+using ValueKey = std::pair<CBCOpcode, std::vector<uint64_t>>;
+
+struct ValueEntry {
+  Ins *ins;
+  /* register which keeps the result of 'ins' */
+  LiteralIndex holder;
+};
+
+class GlobalValueNumbering : public Pass {
+public:
+  GlobalValueNumbering();
+  ~GlobalValueNumbering();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "GlobalValueNumbering"; }
+
+  virtual PassKind kind() { return PassKind::GLOBAL_VALUE_NUMBERING; }
+
+private:
+  void visit(Bytecode *byte_code, BasicBlock *bb);
+  bool valueKey(Bytecode *byte_code, Ins *ins, ValueKey &key);
+  bool isAvailable(LiteralIndex reg);
+  LiteralIndex holder(Bytecode *byte_code, ValueEntry &entry);
+
+  std::unordered_map<BasicBlock *, BasicBlockList> children_;
+  std::map<ValueKey, ValueEntry> table_;
+  RegisterAnalysis registers_;
+  /* registers whose only write dominates the current instruction */
+  RegSet available_;
+};
+
+} // namespace optimizer
+
+#endif // GLOBAL_VALUE_NUMBERING_H
@@ -0,0 +1,97 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "ident-promotion.h"
+#include "optimizer.h"
+#include "scope-analysis.h"
+
+namespace optimizer {
+
+IdentPromotion::IdentPromotion() : Pass() {}
+
+IdentPromotion::~IdentPromotion() {}
+
+bool IdentPromotion::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::CONTROL_FLOW_ANALYSIS));
+
+  /* the variables of the global code are properties of the global object */
+  if (!byte_code->flags().isFunction() ||
+      !collectCaptured(optimizer, byte_code)) {
+    return true;
+  }
+
+  for (auto ins : byte_code->instructions()) {
+    if (ScopeAnalysis::isDynamicScope(ins) ||
+        ins->opcode().opcodeData().groupOpcode() ==
+            VM_OC_BLOCK_CREATE_CONTEXT) {
+      return true;
+    }
+  }
+
+  InsList region(byte_code->instructions());
+
+  /* promoted identifiers move up by one with each new register */
+  for (LiteralIndex i = byte_code->args().registerEnd();
+       i < byte_code->args().identEnd(); i++) {
+    if (isPromotable(byte_code, region, i)) {
+      ScopeAnalysis::promote(byte_code, region, i);
+      i++;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Names of the nested functions may refer to any binding of the function,
+ * an eval in them may refer to all of them
+ */
+bool IdentPromotion::collectCaptured(Optimizer *optimizer,
+                                     Bytecode *byte_code) {
+  captured_.clear();
+
+  for (auto function : optimizer->list()) {
+    if (!ScopeAnalysis::isDescendant(function, byte_code)) {
+      continue;
+    }
+
+    if (ScopeAnalysis::hasDynamicScope(function)) {
+      return false;
+    }
+
+    BytecodeArguments &args = function->args();
+
+    for (LiteralIndex i = args.registerEnd(); i < args.identEnd(); i++) {
+      captured_.insert(function->literalPool().at(i));
+    }
+  }
+
+  return true;
+}
+
+/**
+ * A 'var' binding of the function which is only read and written by name
+ */
+bool IdentPromotion::isPromotable(Bytecode *byte_code, InsList &region,
+                                  LiteralIndex ident) {
+  if (captured_.count(byte_code->literalPool().at(ident)) != 0) {
+    return false;
+  }
+
+  IdentAccesses accesses;
+
+  if (!ScopeAnalysis::isPromotable(region, ident, accesses) ||
+      accesses.declarations.size() != 1 ||
+      !accesses.initializations.empty()) {
+    return false;
+  }
+
+  return accesses.declarations[0]->opcode().is(CBC_CREATE_VAR);
+}
+
+} // namespace optimizer
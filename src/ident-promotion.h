@@ -0,0 +1,43 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef IDENT_PROMOTION_H
+#define IDENT_PROMOTION_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class IdentPromotion : public Pass {
+public:
+  IdentPromotion();
+  ~IdentPromotion();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "IdentPromotion"; }
+
+  virtual PassKind kind() { return PassKind::IDENT_PROMOTION; }
+
+private:
+  bool collectCaptured(Optimizer *optimizer, Bytecode *byte_code);
+  bool isPromotable(Bytecode *byte_code, InsList &region, LiteralIndex ident);
+
+  /* identifiers referenced by the nested functions */
+  std::unordered_set<ecma_value_t> captured_;
+};
+
+} // namespace optimizer
+
+#endif // IDENT_PROMOTION_H
@@ -10,18 +10,20 @@
 
 namespace optimizer {
 
-void Argument::emit(Bytecode *byte_code, std::vector<uint8_t> &buffer) {
+void Argument::emitBranchOffset(uint32_t length,
+                                std::vector<uint8_t> &buffer) {
+  assert(type_ == OperandType::BRANCH);
+  assert(branchOffsetLength(branch_offset_) <= length);
 
-  if (type_ == OperandType::BRANCH) {
-    uint32_t offset = static_cast<uint32_t>(branch_offset_);
+  uint32_t offset = static_cast<uint32_t>(std::abs(branch_offset_));
 
-    while (offset != 0) {
-      buffer.push_back(offset & 0xFF);
-      offset >>= 8;
-    }
-    return;
+  /* branch offsets are stored in big-endian order */
+  for (int32_t shift = (length - 1) * 8; shift >= 0; shift -= 8) {
+    buffer.push_back(static_cast<uint8_t>(offset >> shift));
   }
+}
 
+void Argument::emit(Bytecode *byte_code, std::vector<uint8_t> &buffer) {
   for (auto &lit : literals_) {
     lit.emit(byte_code, buffer);
   }
@@ -37,7 +39,8 @@ void Literal::emit(Bytecode *byte_code, std::vector<uint8_t> &buffer) {
     return;
   }
 
-  if (index_ <= CBC_MAXIMUM_SMALL_VALUE) {
+  if (!byte_code->flags().fullLiteralEncoding()) {
+    assert(index_ <= CBC_MAXIMUM_SMALL_VALUE);
     buffer.push_back(CBC_MAXIMUM_BYTE_VALUE);
     buffer.push_back(static_cast<uint8_t>(index_ - CBC_MAXIMUM_BYTE_VALUE));
     return;
@@ -428,24 +431,26 @@ void Ins::decodeGroupOpcode() {
   case VM_OC_INIT_ARG_OR_FUNC: {
     LiteralIndex literal_index = decodeLiteralIndex();
     LiteralIndex value_index = decodeLiteralIndex();
-    ValueRef lit_value;
+    bool is_register = literal_index < byteCode()->args().registerEnd();
 
-    if (value_index < byteCode()->args().registerEnd()) {
-      uint32_t reg_index = byteCode()->toRegisterIndex(value_index);
-      addReadReg(reg_index);
-      lit_value = stack().getRegister(reg_index);
+    /* operands must be recorded in their encoding order */
+    if (is_register) {
+      setWriteReg(byteCode()->toRegisterIndex(literal_index));
     } else {
-      lit_value = Value::_object();
+      setStringLiteral(literal_index);
     }
 
-    if (literal_index < byteCode()->args().registerEnd()) {
-      uint32_t reg_index = byteCode()->toRegisterIndex(literal_index);
-      setWriteReg(reg_index);
-      stack().setRegister(reg_index, lit_value);
+    Literal value = decodeLiteral(value_index);
+    ValueRef lit_value = value.type() == LiteralType::TEMPLATE
+                             ? Value::_object()
+                             : value.toValueRef(byteCode());
+
+    if (is_register) {
+      stack().setRegister(byteCode()->toRegisterIndex(literal_index),
+                          lit_value);
       break;
     }
 
-    setStringLiteral(literal_index);
     setLiteralValue(lit_value);
     break;
   }
@@ -777,15 +782,12 @@ void Ins::decodeGroupOpcode() {
     break;
   }
   case VM_OC_IDENT_REFERENCE: {
-    LiteralIndex literal_index = decodeLiteralIndex();
+    Literal literal = decodeLiteral();
 
-    if (literal_index < byteCode()->args().registerEnd()) {
+    if (literal.index() < byteCode()->args().registerEnd()) {
       stack().push(Value::_internal());
-      stack().push(Value::_number(literal_index));
-
-      uint32_t reg_index = byteCode()->toRegisterIndex(literal_index);
-      addReadReg(reg_index);
-      stack().push(stack().getRegister(reg_index));
+      stack().push(Value::_number(literal.index()));
+      stack().push(literal.toValueRef(byteCode()));
     } else {
       stack().push(Value::_object());
       stack().push(Value::_string());
@@ -852,6 +854,12 @@ void Ins::decodeGroupOpcode() {
     }
     stack().setResult(Value::_any());
     processPut();
+
+    /* the ident operand is read twice but encoded only once */
+    if (opcode_flags & VM_OC_IDENT_INCR_DECR_OPERATOR_FLAG) {
+      argument_.literals().pop_back();
+      updateRegisters();
+    }
     break;
   }
   case VM_OC_ASSIGN: {
@@ -959,9 +967,9 @@ void Ins::decodeGroupOpcode() {
     break;
   }
   case VM_OC_DELETE: {
-    LiteralIndex literal_index = decodeLiteralIndex();
+    Literal literal = decodeLiteral();
 
-    if (literal_index < byteCode()->args().registerEnd()) {
+    if (literal.index() < byteCode()->args().registerEnd()) {
       stack().push(Value::_false());
     } else {
       stack().push(Value::_boolean());
@@ -1012,16 +1020,8 @@ void Ins::decodeGroupOpcode() {
     break;
   }
   case VM_OC_TYPEOF_IDENT: {
-    LiteralIndex literal_index = decodeLiteralIndex();
-
-    if (literal_index < byteCode()->args().registerEnd()) {
-
-      uint32_t reg_index = byteCode()->toRegisterIndex(literal_index);
-      addReadReg(reg_index);
-      stack().setLeft(stack().getRegister(reg_index));
-    } else {
-      stack().setLeft(Value::_any());
-    }
+    Literal literal = decodeLiteral();
+    stack().setLeft(literal.toValueRef(byteCode()));
     /* FALLTHRU */
   }
   case VM_OC_TYPEOF: {
@@ -1080,13 +1080,16 @@ void Ins::decodeGroupOpcode() {
   }
   case VM_OC_BLOCK_CREATE_CONTEXT: {
 #if ENABLED(JERRY_ESNEXT)
-    stack().push(PARSER_BLOCK_CONTEXT_STACK_ALLOCATION);
+    /* the environment of a catch block belongs to the try context */
+    if (argument_.type() == OperandType::BRANCH) {
+      stack().pushContext(PARSER_BLOCK_CONTEXT_STACK_ALLOCATION);
+    }
 #endif /* ENABLED (JERRY_ESNEXT) */
     break;
   }
   case VM_OC_WITH: {
     setLiteralValue(stack().pop());
-    stack().push(PARSER_BLOCK_CONTEXT_STACK_ALLOCATION);
+    stack().pushContext(PARSER_BLOCK_CONTEXT_STACK_ALLOCATION);
     break;
   }
   case VM_OC_FOR_IN_INIT: {
@@ -1137,6 +1140,7 @@ void Ins::decodeGroupOpcode() {
   case VM_OC_TRY: {
     addFlag(InstFlags::JUMP);
     addFlag(InstFlags::TRY_START);
+    stack().pushContext(PARSER_TRY_CONTEXT_STACK_ALLOCATION);
     break;
   }
   case VM_OC_CATCH: {
@@ -1147,11 +1151,12 @@ void Ins::decodeGroupOpcode() {
   case VM_OC_FINALLY: {
     addFlag(InstFlags::JUMP);
     addFlag(InstFlags::TRY_FINALLY);
-    stack().push(PARSER_FINALLY_CONTEXT_EXTRA_STACK_ALLOCATION);
+    stack().extendContext(PARSER_FINALLY_CONTEXT_EXTRA_STACK_ALLOCATION);
     break;
   }
   case VM_OC_CONTEXT_END: {
-    // TODO: support
+    /* the innermost block, with or try context ends */
+    stack().popContext();
     break;
   }
   case VM_OC_JUMP_AND_EXIT_CONTEXT: {
@@ -1188,6 +1193,88 @@ void Ins::decodeGroupOpcode() {
   }
 }
 
+Ins *Ins::create(Bytecode *byte_code, Opcode opcode,
+                 const std::vector<Literal> &literals) {
+  Ins *ins = new Ins(byte_code);
+  ins->opcode_ = opcode;
+  ins->argument_ = Argument(opcode.opcodeData().operands());
+
+  for (auto &literal : literals) {
+    ins->argument_.addLiteral(literal);
+  }
+
+  ins->updateFlags();
+  ins->updateRegisters();
+  return ins;
+}
+
+/**
+ * Detached copy with the same operands, the offset is set on insertion
+ */
+Ins *Ins::clone() {
+  Ins *ins = create(byte_code_, opcode_, argument_.literals());
+  ins->argument_ = argument_;
+  return ins;
+}
+
+void Ins::updateFlags() {
+  removeFlag(InstFlags::JUMP);
+  removeFlag(InstFlags::CONDITIONAL_JUMP);
+
+  switch (opcode().opcodeData().groupOpcode()) {
+  case VM_OC_JUMP: {
+    addFlag(InstFlags::JUMP);
+    break;
+  }
+  case VM_OC_BRANCH_IF_STRICT_EQUAL:
+  case VM_OC_BRANCH_IF_TRUE:
+  case VM_OC_BRANCH_IF_FALSE:
+  case VM_OC_BRANCH_IF_LOGICAL_TRUE:
+  case VM_OC_BRANCH_IF_LOGICAL_FALSE: {
+    addFlag(InstFlags::JUMP);
+    addFlag(InstFlags::CONDITIONAL_JUMP);
+    break;
+  }
+  default: {
+    break;
+  }
+  }
+}
+
+void Ins::updateRegisters() {
+  removeFlag(InstFlags::READ_REG);
+  removeFlag(InstFlags::WRITE_REG);
+  read_regs_.clear();
+
+  auto &literals = argument_.literals();
+  auto register_end = byteCode()->args().registerEnd();
+  OpcodeData data = opcode().opcodeData();
+  GroupOpcode group = data.groupOpcode();
+  size_t read_count = literals.size();
+
+  /* the destination is always encoded last */
+  if (!literals.empty() && (data.isPutIdent() || group == VM_OC_MOV_IDENT)) {
+    LiteralIndex destination = literals.back().index();
+
+    if (destination < register_end) {
+      addFlag(InstFlags::WRITE_REG);
+      write_reg_ = byteCode()->toRegisterIndex(destination);
+    }
+
+    /* increment and decrement read and write the same literal */
+    if (group < VM_OC_PRE_INCR || group > VM_OC_POST_DECR) {
+      read_count--;
+    }
+  }
+
+  for (size_t i = 0; i < read_count; i++) {
+    if (literals[i].index() < register_end) {
+      addFlag(InstFlags::READ_REG);
+      read_regs_.push_back(literals[i].index());
+    }
+  }
+}
+
 void Ins::emit(std::vector<uint8_t> &buffer) {
   if (opcode_.isExt(CBC_EXT_LINE)) {
     buffer.push_back(CBC_EXT_OPCODE);
@@ -1200,17 +1287,33 @@ void Ins::emit(std::vector<uint8_t> &buffer) {
     do {
       tmp.push_back(line & CBC_LOWER_SEVEN_BIT_MASK);
       line >>= 7;
-    } while (line & CBC_HIGHEST_BIT_MASK);
+    } while (line != 0);
 
-    for (auto byte : tmp) {
-      buffer.push_back(byte);
+    /* the decoder reads the highest seven bits first, every byte except the
+       last one has the continuation bit set */
+    for (size_t i = tmp.size() - 1; i > 0; i--) {
+      buffer.push_back(tmp[i] | CBC_HIGHEST_BIT_MASK);
     }
 
+    buffer.push_back(tmp[0]);
+
     return;
   }
 
   opcode_.emit(buffer);
+
+  if (argument_.type() == OperandType::BRANCH) {
+    argument_.emitBranchOffset(opcode_.branchOffsetLength(), buffer);
+    return;
+  }
+
   argument_.emit(byte_code_, buffer);
 }
 
+size_t Ins::encodedSize() {
+  std::vector<uint8_t> buffer;
+  emit(buffer);
+  return buffer.size();
+}
+
 } // namespace optimizer
@@ -113,7 +113,7 @@ public:
   void setLineInfo(uint32_t line) { line_info_ = line; }
   void setByteArg(uint8_t byte) { byte_arg_ = byte; }
 
-  void addLiteral(Literal &literal) { literals_.push_back(literal); }
+  void addLiteral(const Literal &literal) { literals_.push_back(literal); }
 
   bool isLiteral() const { return type() >= OperandType::LITERAL; }
   bool isLiteralLiteral() const {
@@ -121,6 +121,17 @@ public:
   }
 
   void emit(Bytecode *byte_code, std::vector<uint8_t> &buffer);
+  void emitBranchOffset(uint32_t length, std::vector<uint8_t> &buffer);
+
+  static uint32_t branchOffsetLength(int32_t offset) {
+    uint32_t abs_offset = static_cast<uint32_t>(std::abs(offset));
+
+    if (abs_offset <= UINT8_MAX) {
+      return 1;
+    }
+
+    return abs_offset <= UINT16_MAX ? 2 : 3;
+  }
 
 private:
   OperandType type_;
@@ -133,17 +144,17 @@ private:
 
 class OpcodeData {
 public:
-  OpcodeData() : OpcodeData(0) {}
-  OpcodeData(uint32_t data) : data_(data) {}
+  constexpr OpcodeData() : OpcodeData(0) {}
+  constexpr OpcodeData(uint32_t data) : data_(data) {}
 
-  auto data() const { return data_; }
+  constexpr uint32_t data() const { return data_; }
 
-  OperandType operands() const {
+  constexpr OperandType operands() const {
     return static_cast<OperandType>((data() >> VM_OC_GET_ARGS_SHIFT) &
                                     VM_OC_GET_ARGS_MASK);
   }
 
-  GroupOpcode groupOpcode() const {
+  constexpr GroupOpcode groupOpcode() const {
     return static_cast<GroupOpcode>((data() & VM_OC_GROUP_MASK));
   }
 
@@ -157,7 +168,7 @@ public:
     return (putResult() & static_cast<uint32_t>(ResultFlag::BLOCK)) != 0;
   }
 
-  bool isPutIdent() {
+  constexpr bool isPutIdent() const {
     return (putResult() & static_cast<uint32_t>(ResultFlag::IDENT)) != 0;
   }
 
@@ -172,11 +183,11 @@ public:
   bool isForwardBrach() const { return !isBackwardBrach(); }
 
   void removeFlag(ResultFlag flag) {
-    data_ &= ~static_cast<uint32_t>(ResultFlag::STACK);
+    data_ &= ~(static_cast<uint32_t>(flag) << VM_OC_PUT_RESULT_SHIFT);
   }
 
 private:
-  uint32_t putResult() const {
+  constexpr uint32_t putResult() const {
     return (data() >> VM_OC_PUT_RESULT_SHIFT) & VM_OC_PUT_RESULT_MASK;
   }
 
@@ -187,16 +198,43 @@ class Opcode {
 public:
   Opcode() : Opcode(0) {}
   Opcode(CBCOpcode opcode)
-      : cbc_opcode_(opcode), opcode_data_(decode_table[opcode]) {
+      : cbc_opcode_(opcode), opcode_data_(decode_table[decodeIndex(opcode)]) {
 #ifndef NDEBUG
     if (!isExtOpcode()) {
       cbc_op_ = static_cast<cbc_opcode_t>(cbc_opcode_);
       cbc_ext_op_ = CBC_EXT_NOP;
-      group_op_ = static_cast<vm_oc_types>(opcode_data_.groupOpcode());
+    } else {
+      cbc_op_ = CBC_END;
+      cbc_ext_op_ = static_cast<cbc_ext_opcode_t>(cbc_opcode_ - 256);
     }
+    group_op_ = static_cast<vm_oc_types>(opcode_data_.groupOpcode());
 #endif /* !NDEBUG */
   }
 
+  static Opcode ext(CBCOpcode opcode) {
+    return Opcode(static_cast<CBCOpcode>(opcode + 256));
+  }
+
+  /**
+   * Jump or branch of the group in the given direction
+   */
+  static Opcode directed(GroupOpcode group, bool backward) {
+    switch (group) {
+    case VM_OC_JUMP: {
+      return Opcode(backward ? CBC_JUMP_BACKWARD : CBC_JUMP_FORWARD);
+    }
+    case VM_OC_BRANCH_IF_TRUE: {
+      return Opcode(backward ? CBC_BRANCH_IF_TRUE_BACKWARD
+                             : CBC_BRANCH_IF_TRUE_FORWARD);
+    }
+    default: {
+      assert(group == VM_OC_BRANCH_IF_FALSE);
+      return Opcode(backward ? CBC_BRANCH_IF_FALSE_BACKWARD
+                             : CBC_BRANCH_IF_FALSE_FORWARD);
+    }
+    }
+  }
+
   auto CBCopcode() const { return cbc_opcode_; }
   auto opcodeData() const { return opcode_data_; }
 
@@ -220,12 +258,27 @@ public:
 
   bool isExtOpcode() const { return Opcode::isExtOpcode(CBCopcode()); }
 
-  static bool isExtOpcode(CBCOpcode opcode) { return opcode > CBC_END; }
+  static constexpr bool isExtOpcode(CBCOpcode opcode) {
+    return opcode > CBC_END;
+  }
+  static constexpr uint32_t decodeIndex(CBCOpcode opcode) {
+    return isExtOpcode(opcode) ? opcode - 256 + CBC_END + 1 : opcode;
+  }
   static bool isEndOpcode(CBCOpcode opcode) { return opcode == CBC_EXT_NOP; }
   static bool isExtStartOpcode(CBCOpcode opcode) {
     return opcode == CBC_EXT_OPCODE;
   }
 
+  uint32_t branchOffsetLength() const {
+    return CBC_BRANCH_OFFSET_LENGTH(cbc_opcode_);
+  }
+
+  void setBranchOffsetLength(uint32_t length) {
+    assert(length >= 1 && length <= 3);
+    *this = Opcode(
+        static_cast<CBCOpcode>(cbc_opcode_ - branchOffsetLength() + length));
+  }
+
   void toExtOpcode(CBCOpcode cbc_op) {
     assert(Opcode::isExtStartOpcode(CBCopcode()));
     assert(!Opcode::isEndOpcode(cbc_op));
@@ -268,7 +321,8 @@ public:
   Ins(Bytecode *byte_code)
       : byte_code_(byte_code), stack_snapshot_(nullptr),
         string_literal_(Value::_undefined()),
-        literal_value_(Value::_undefined()), flags_(0), offset_(0) {}
+        literal_value_(Value::_undefined()), bb_(nullptr), flags_(0),
+        offset_(0), size_(0) {}
 
   ~Ins() { delete stack_snapshot_; }
 
@@ -299,6 +353,7 @@ public:
   }
 
   void addFlag(InstFlags flag) { flags_ |= static_cast<uint32_t>(flag); }
+  void removeFlag(InstFlags flag) { flags_ &= ~static_cast<uint32_t>(flag); }
 
   int32_t jumpOffset() const {
     assert(isJump());
@@ -375,6 +430,9 @@ public:
 
   void setSize(size_t size) { size_ = size; }
 
+  /* Move the instruction without touching its neighbours */
+  void relocate(uint32_t offset) { offset_ = offset; }
+
   void setBasicBlock(BasicBlock *bb) { bb_ = bb; }
 
   LiteralIndex decodeLiteralIndex();
@@ -387,6 +445,12 @@ public:
   void processPut();
   void decodeGroupOpcode();
 
+  static Ins *create(Bytecode *byte_code, Opcode opcode,
+                     const std::vector<Literal> &literals);
+  Ins *clone();
+  void updateFlags();
+  void updateRegisters();
+
   void setWriteReg(uint32_t index) {
     addFlag(InstFlags::WRITE_REG);
     write_reg_ = index;
@@ -442,6 +506,7 @@ public:
   }
 
   void emit(std::vector<uint8_t> &buffer);
+  size_t encodedSize();
 
 private:
   Bytecode *byte_code_;
@@ -0,0 +1,240 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "line-info-minimization.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+LineInfoMinimization::LineInfoMinimization(bool strip)
+    : Pass(), strip_(strip) {}
+
+LineInfoMinimization::~LineInfoMinimization() {}
+
+bool LineInfoMinimization::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::CONTROL_FLOW_ANALYSIS));
+
+  if (strip_) {
+    InsList lines;
+
+    for (auto ins : byte_code->instructions()) {
+      if (isLine(ins)) {
+        lines.push_back(ins);
+      }
+    }
+
+    for (auto ins : lines) {
+      byte_code->removeIns(ins);
+    }
+
+    return true;
+  }
+
+  /* the handlers of a try context are only linked to the block of its start,
+     and a return in it may continue with a finally block */
+  for (auto ins : byte_code->instructions()) {
+    if (ins->isTryContext()) {
+      return true;
+    }
+  }
+
+  for (auto bb : byte_code->basicBlockList()) {
+    removeUnobserved(byte_code, bb);
+  }
+
+  computeLines(byte_code);
+
+  for (auto bb : byte_code->basicBlockList()) {
+    removeRepeated(byte_code, bb);
+  }
+
+  return true;
+}
+
+/**
+ * The line is only observed by a throw. A marker which is superseded by the
+ * next one of its block before anything could throw is not needed.
+ */
+void LineInfoMinimization::removeUnobserved(Bytecode *byte_code,
+                                            BasicBlock *bb) {
+  InsList unobserved;
+  Ins *line = nullptr;
+
+  for (auto ins : bb->insns()) {
+    if (isLine(ins)) {
+      if (line != nullptr) {
+        unobserved.push_back(line);
+      }
+
+      line = ins;
+      continue;
+    }
+
+    if (canThrow(byte_code, ins)) {
+      line = nullptr;
+    }
+  }
+
+  /* nothing can throw after the last marker of a returning block */
+  if (line != nullptr &&
+      bb->insns().back()->opcode().opcodeData().groupOpcode() ==
+          VM_OC_RETURN) {
+    unobserved.push_back(line);
+  }
+
+  for (auto ins : unobserved) {
+    LOG("Remove unobserved line: " << *ins);
+    byte_code->removeIns(ins);
+  }
+}
+
+/**
+ * Forward dataflow of the current line: a block starts with a known line if
+ * all of its predecessors end with the same one
+ */
+void LineInfoMinimization::computeLines(Bytecode *byte_code) {
+  BasicBlockList &bbs = byte_code->basicBlockList();
+  exit_lines_.clear();
+
+  for (auto bb : bbs) {
+    exit_lines_[bb] = LINE_INFO_UNKNOWN;
+  }
+
+  /* a block of a loop may be decided by its own exit line, so the number of
+     iterations is bounded */
+  for (size_t i = 0; i <= bbs.size(); i++) {
+    bool changed = false;
+
+    for (auto bb : bbs) {
+      uint32_t line = entryLine(bb);
+
+      for (auto ins : bb->insns()) {
+        if (isLine(ins)) {
+          line = ins->argument().lineInfo();
+        }
+      }
+
+      if (exit_lines_[bb] != line) {
+        exit_lines_[bb] = line;
+        changed = true;
+      }
+    }
+
+    if (!changed) {
+      return;
+    }
+  }
+
+  /* no fixpoint, nothing is known */
+  for (auto bb : bbs) {
+    exit_lines_[bb] = LINE_INFO_UNKNOWN;
+  }
+}
+
+void LineInfoMinimization::removeRepeated(Bytecode *byte_code,
+                                          BasicBlock *bb) {
+  uint32_t line = entryLine(bb);
+  InsList repeated;
+
+  for (auto ins : bb->insns()) {
+    if (!isLine(ins)) {
+      continue;
+    }
+
+    if (ins->argument().lineInfo() == line) {
+      repeated.push_back(ins);
+      continue;
+    }
+
+    line = ins->argument().lineInfo();
+  }
+
+  for (auto ins : repeated) {
+    LOG("Remove repeated line: " << *ins);
+    byte_code->removeIns(ins);
+  }
+}
+
+uint32_t LineInfoMinimization::entryLine(BasicBlock *bb) {
+  if (!bb->isValid() || bb->predecessors().empty()) {
+    return LINE_INFO_UNKNOWN;
+  }
+
+  uint32_t line = exit_lines_[bb->predecessors().front()];
+
+  for (auto pred : bb->predecessors()) {
+    if (!pred->isValid() || exit_lines_[pred] != line) {
+      return LINE_INFO_UNKNOWN;
+    }
+  }
+
+  return line;
+}
+
+bool LineInfoMinimization::isLine(Ins *ins) {
+  return ins->opcode().isExt(CBC_EXT_LINE);
+}
+
+/**
+ * Conservative: only stack shuffling, branches and register moves are known
+ * not to throw, identifiers may be unresolvable and properties may have
+ * accessors
+ */
+bool LineInfoMinimization::canThrow(Bytecode *byte_code, Ins *ins) {
+  for (auto &literal : ins->argument().literals()) {
+    if (literal.index() >= byte_code->args().registerEnd() &&
+        literal.index() < byte_code->args().identEnd()) {
+      return true;
+    }
+  }
+
+  OpcodeData data = ins->opcode().opcodeData();
+
+  if (ins->opcode().isExtOpcode() || data.isPutReference()) {
+    return true;
+  }
+
+  switch (data.groupOpcode()) {
+  case VM_OC_POP:
+  case VM_OC_POP_BLOCK:
+  case VM_OC_PUSH:
+  case VM_OC_PUSH_TWO:
+  case VM_OC_PUSH_THREE:
+  case VM_OC_PUSH_UNDEFINED:
+  case VM_OC_PUSH_TRUE:
+  case VM_OC_PUSH_FALSE:
+  case VM_OC_PUSH_NULL:
+  case VM_OC_PUSH_0:
+  case VM_OC_PUSH_POS_BYTE:
+  case VM_OC_PUSH_NEG_BYTE:
+  case VM_OC_PUSH_LIT_0:
+  case VM_OC_PUSH_LIT_POS_BYTE:
+  case VM_OC_PUSH_LIT_NEG_BYTE:
+  case VM_OC_MOV_IDENT:
+  case VM_OC_ASSIGN:
+  case VM_OC_JUMP:
+  case VM_OC_BRANCH_IF_TRUE:
+  case VM_OC_BRANCH_IF_FALSE:
+  case VM_OC_BRANCH_IF_LOGICAL_TRUE:
+  case VM_OC_BRANCH_IF_LOGICAL_FALSE:
+  case VM_OC_BRANCH_IF_STRICT_EQUAL:
+  case VM_OC_STRICT_EQUAL:
+  case VM_OC_STRICT_NOT_EQUAL:
+  case VM_OC_NOT:
+  case VM_OC_VOID:
+  case VM_OC_TYPEOF:
+  case VM_OC_RETURN: {
+    return false;
+  }
+  default: {
+    return true;
+  }
+  }
+}
+
+} // namespace optimizer
@@ -0,0 +1,53 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef LINE_INFO_MINIMIZATION_H
+#define LINE_INFO_MINIMIZATION_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+/* line of a block entry which is not known statically */
+#define LINE_INFO_UNKNOWN UINT32_MAX
+
+class LineInfoMinimization : public Pass {
+public:
+  LineInfoMinimization(bool strip = false);
+  ~LineInfoMinimization();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "LineInfoMinimization"; }
+
+  virtual PassKind kind() { return PassKind::LINE_INFO_MINIMIZATION; }
+
+private:
+  void removeUnobserved(Bytecode *byte_code, BasicBlock *bb);
+  void computeLines(Bytecode *byte_code);
+  void removeRepeated(Bytecode *byte_code, BasicBlock *bb);
+  uint32_t entryLine(BasicBlock *bb);
+
+  static bool isLine(Ins *ins);
+  static bool canThrow(Bytecode *byte_code, Ins *ins);
+
+  /* remove every line marker */
+  bool strip_;
+  /* current line at the end of each block */
+  std::unordered_map<BasicBlock *, uint32_t> exit_lines_;
+};
+
+} // namespace optimizer
+
+#endif // LINE_INFO_MINIMIZATION_H
@@ -0,0 +1,138 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "literal-pool-compaction.h"
+#include "inst.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+LiteralPoolCompaction::LiteralPoolCompaction()
+    : Pass(), removed_idents_(0), removed_consts_(0) {}
+
+LiteralPoolCompaction::~LiteralPoolCompaction() {}
+
+bool LiteralPoolCompaction::run(Optimizer *optimizer, Bytecode *byte_code) {
+  removed_idents_ = 0;
+  removed_consts_ = 0;
+
+  findUsedLiterals(byte_code);
+  computeNewIndices(byte_code);
+
+  if (removed_idents_ == 0 && removed_consts_ == 0) {
+    return true;
+  }
+
+  LOG("Removed idents: " << removed_idents_
+                         << " removed consts: " << removed_consts_);
+
+  updateInstructions(byte_code);
+  updateLiteralPool(optimizer, byte_code);
+
+  return true;
+}
+
+void LiteralPoolCompaction::findUsedLiterals(Bytecode *byte_code) {
+  BytecodeArguments &args = byte_code->args();
+  auto &literals = byte_code->literalPool().literals();
+
+  used_.assign(literals.size(), false);
+
+  for (auto ins : byte_code->instructions()) {
+    for (auto &lit : ins->argument().literals()) {
+      if (lit.index() >= args.registerEnd()) {
+        used_[lit.index() - args.registerEnd()] = true;
+      }
+    }
+  }
+
+  /* the declared var idents are addressed by their position */
+  LiteralIndex declared_end = byte_code->declaredIdentEnd();
+
+  for (uint32_t i = args.registerEnd(); i < declared_end; i++) {
+    used_[i - args.registerEnd()] = true;
+  }
+
+  /* function and regexp literals are never removed */
+  for (uint32_t i = args.constLiteralEnd(); i < args.literalEnd(); i++) {
+    used_[i - args.registerEnd()] = true;
+  }
+
+  /* the function name and the mapped argument names must stay available */
+  for (auto value : byte_code->endInfoValues()) {
+    for (size_t i = 0; i < literals.size(); i++) {
+      if (literals[i] == value) {
+        used_[i] = true;
+      }
+    }
+  }
+}
+
+void LiteralPoolCompaction::computeNewIndices(Bytecode *byte_code) {
+  BytecodeArguments &args = byte_code->args();
+  LiteralIndex new_index = args.registerEnd();
+
+  new_index_.resize(used_.size());
+
+  for (uint32_t i = args.registerEnd(); i < args.literalEnd(); i++) {
+    size_t slot = i - args.registerEnd();
+
+    if (used_[slot]) {
+      new_index_[slot] = new_index++;
+      continue;
+    }
+
+    LOG("Remove unused literal: " << i);
+
+    if (i < args.identEnd()) {
+      removed_idents_++;
+    } else {
+      assert(i < args.constLiteralEnd());
+      removed_consts_++;
+    }
+  }
+}
+
+void LiteralPoolCompaction::updateInstructions(Bytecode *byte_code) {
+  LiteralIndex register_end = byte_code->args().registerEnd();
+
+  for (auto ins : byte_code->instructions()) {
+    for (auto &lit : ins->argument().literals()) {
+      if (lit.index() >= register_end) {
+        lit.setIndex(new_index_[lit.index() - register_end]);
+      }
+    }
+  }
+}
+
+void LiteralPoolCompaction::updateLiteralPool(Optimizer *optimizer,
+                                              Bytecode *byte_code) {
+  auto &literals = byte_code->literalPool().literals();
+  std::vector<ecma_value_t> new_literals;
+
+  for (size_t i = 0; i < literals.size(); i++) {
+    if (used_[i]) {
+      new_literals.push_back(literals[i]);
+    }
+  }
+
+  literals = std::move(new_literals);
+  byte_code->args().removeLiterals(removed_idents_, removed_consts_);
+
+  /* sub functions are stored after the removed literals */
+  uint32_t removed_count = removed_idents_ + removed_consts_;
+
+  for (auto sub_byte_code : optimizer->list()) {
+    if (sub_byte_code->parent() == byte_code) {
+      sub_byte_code->setParentLiteralPoolIndex(
+          sub_byte_code->parentLiteralPoolIndex() - removed_count);
+    }
+  }
+}
+
+} // namespace optimizer
@@ -0,0 +1,45 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef LITERAL_POOL_COMPACTION_H
+#define LITERAL_POOL_COMPACTION_H
+
+#include "bytecode.h"
+#include "common.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class LiteralPoolCompaction : public Pass {
+public:
+  LiteralPoolCompaction();
+  ~LiteralPoolCompaction();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "LiteralPoolCompaction"; }
+
+  virtual PassKind kind() { return PassKind::LITERAL_POOL_COMPACTION; }
+
+private:
+  void findUsedLiterals(Bytecode *byte_code);
+  void computeNewIndices(Bytecode *byte_code);
+  void updateInstructions(Bytecode *byte_code);
+  void updateLiteralPool(Optimizer *optimizer, Bytecode *byte_code);
+
+  std::vector<bool> used_;
+  std::vector<LiteralIndex> new_index_;
+  uint16_t removed_idents_;
+  uint16_t removed_consts_;
+};
+
+} // namespace optimizer
+
+#endif // LITERAL_POOL_COMPACTION_H
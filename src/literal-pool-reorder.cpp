@@ -0,0 +1,120 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "literal-pool-reorder.h"
+#include "basic-block.h"
+#include "loop-analysis.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+LiteralPoolReorder::LiteralPoolReorder() : Pass() {}
+
+LiteralPoolReorder::~LiteralPoolReorder() {}
+
+bool LiteralPoolReorder::run(Optimizer *optimizer, Bytecode *byte_code) {
+  BytecodeArguments &args = byte_code->args();
+  byte_code->updateEncoding();
+
+  /* every ident and constant literal fits into a single byte already */
+  if (args.constLiteralEnd() <= args.oneByteLimit() + 1) {
+    return true;
+  }
+
+  uses_.assign(byte_code->literalPool().size(), 0);
+  new_index_.resize(byte_code->literalPool().size());
+
+  for (size_t i = 0; i < new_index_.size(); i++) {
+    new_index_[i] = static_cast<LiteralIndex>(args.registerEnd() + i);
+  }
+
+  countUses(optimizer, byte_code);
+
+  /* idents and constants are resolved differently by the vm, therefore each
+     section is reordered separately, the declared var idents are addressed
+     by their position so they keep their index */
+  bool changed =
+      reorderRange(byte_code, byte_code->declaredIdentEnd(), args.identEnd());
+  changed |= reorderRange(byte_code, args.identEnd(), args.constLiteralEnd());
+
+  if (changed) {
+    updateInstructions(byte_code);
+  }
+
+  return true;
+}
+
+void LiteralPoolReorder::countUses(Optimizer *optimizer, Bytecode *byte_code) {
+  bool has_loops = optimizer->isSucceeded(PassKind::LOOP_ANALYSIS);
+  LiteralIndex register_end = byte_code->args().registerEnd();
+
+  for (auto ins : byte_code->instructions()) {
+    uint32_t weight = 1;
+
+    if (has_loops && ins->bb() != nullptr) {
+      weight = LoopAnalysis::weight(ins->bb()->loopDepth());
+    }
+
+    for (auto &lit : ins->argument().literals()) {
+      if (lit.type() == LiteralType::IDENT ||
+          lit.type() == LiteralType::CONSTANT) {
+        uses_[lit.index() - register_end] += weight;
+      }
+    }
+  }
+}
+
+bool LiteralPoolReorder::reorderRange(Bytecode *byte_code, LiteralIndex start,
+                                      LiteralIndex end) {
+  LiteralIndex register_end = byte_code->args().registerEnd();
+  std::vector<LiteralIndex> order;
+
+  for (LiteralIndex i = start; i < end; i++) {
+    order.push_back(i);
+  }
+
+  std::stable_sort(order.begin(), order.end(),
+                   [this, register_end](LiteralIndex a, LiteralIndex b) {
+                     return uses_[a - register_end] > uses_[b - register_end];
+                   });
+
+  auto &literals = byte_code->literalPool().literals();
+  std::vector<ecma_value_t> old_literals(literals);
+  bool changed = false;
+
+  for (size_t i = 0; i < order.size(); i++) {
+    LiteralIndex new_index = static_cast<LiteralIndex>(start + i);
+
+    if (order[i] != new_index) {
+      changed = true;
+    }
+
+    LOG("Literal: " << order[i] << " uses: " << uses_[order[i] - register_end]
+                    << " new index: " << new_index);
+
+    new_index_[order[i] - register_end] = new_index;
+    literals[new_index - register_end] = old_literals[order[i] - register_end];
+  }
+
+  return changed;
+}
+
+void LiteralPoolReorder::updateInstructions(Bytecode *byte_code) {
+  LiteralIndex register_end = byte_code->args().registerEnd();
+
+  for (auto ins : byte_code->instructions()) {
+    for (auto &lit : ins->argument().literals()) {
+      if (lit.type() == LiteralType::IDENT ||
+          lit.type() == LiteralType::CONSTANT) {
+        lit.setIndex(new_index_[lit.index() - register_end]);
+      }
+    }
+  }
+}
+
+} // namespace optimizer
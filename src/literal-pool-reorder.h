@@ -0,0 +1,42 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef LITERAL_POOL_REORDER_H
+#define LITERAL_POOL_REORDER_H
+
+#include "bytecode.h"
+#include "common.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class LiteralPoolReorder : public Pass {
+public:
+  LiteralPoolReorder();
+  ~LiteralPoolReorder();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "LiteralPoolReorder"; }
+
+  virtual PassKind kind() { return PassKind::LITERAL_POOL_REORDER; }
+
+private:
+  void countUses(Optimizer *optimizer, Bytecode *byte_code);
+  bool reorderRange(Bytecode *byte_code, LiteralIndex start, LiteralIndex end);
+  void updateInstructions(Bytecode *byte_code);
+
+  std::vector<uint32_t> uses_;
+  std::vector<LiteralIndex> new_index_;
+};
+
+} // namespace optimizer
+
+#endif // LITERAL_POOL_REORDER_H
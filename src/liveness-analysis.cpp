@@ -8,6 +8,7 @@
 
 #include "liveness-analysis.h"
 #include "basic-block.h"
+#include "loop-analysis.h"
 #include "optimizer.h"
 
 namespace optimizer {
@@ -37,11 +38,127 @@ bool LivenessAnalysis::run(Optimizer *optimizer, Bytecode *byte_code) {
   return true;
 }
 
+/**
+ * Registers read by the instruction. The decoded destination of a register
+ * write is also listed in its read registers, so it is skipped.
+ */
+RegList LivenessAnalysis::uses(Ins *ins) {
+  auto &literals = ins->argument().literals();
+  OpcodeData data = ins->opcode().opcodeData();
+  GroupOpcode group = data.groupOpcode();
+  uint32_t register_end = ins->byteCode()->args().registerEnd();
+  size_t destination = literals.size();
+
+  if (ins->hasFlag(InstFlags::WRITE_REG) && !literals.empty()) {
+    if (group == VM_OC_INIT_ARG_OR_FUNC || group == VM_OC_CREATE_ARGUMENTS) {
+      destination = 0;
+    } else if ((data.isPutIdent() || group == VM_OC_MOV_IDENT) &&
+               (group < VM_OC_PRE_INCR || group > VM_OC_POST_DECR)) {
+      destination = literals.size() - 1;
+    }
+
+    if (destination < literals.size() &&
+        literals[destination].index() != ins->writeReg()) {
+      destination = literals.size();
+    }
+  }
+
+  RegList regs;
+
+  for (size_t i = 0; i < literals.size(); i++) {
+    if (i != destination && literals[i].index() < register_end) {
+      regs.push_back(literals[i].index());
+    }
+  }
+
+  return regs;
+}
+
+RegSet LivenessAnalysis::liveIn(BasicBlock *bb) {
+  RegSet live = bb->ue();
+
+  for (auto reg : bb->liveOut()) {
+    if (bb->kill().find(reg) == bb->kill().end()) {
+      live.insert(reg);
+    }
+  }
+
+  return live;
+}
+
+/**
+ * Give the lowest register indices to the most frequently accessed
+ * registers, only these are encoded in a single byte. Arguments are
+ * passed in their registers, so they keep their index.
+ */
+void LivenessAnalysis::orderRegisters(Optimizer *optimizer,
+                                      Bytecode *byte_code) {
+  BytecodeArguments &args = byte_code->args();
+  bool has_loops = optimizer->isSucceeded(PassKind::LOOP_ANALYSIS);
+  std::vector<uint32_t> uses(args.registerEnd(), 0);
+
+  for (auto ins : byte_code->instructions()) {
+    uint32_t weight = 1;
+
+    if (has_loops && ins->bb() != nullptr) {
+      weight = LoopAnalysis::weight(ins->bb()->loopDepth());
+    }
+
+    for (auto &lit : ins->argument().literals()) {
+      if (lit.index() < args.registerEnd()) {
+        uses[lit.index()] += weight;
+      }
+    }
+  }
+
+  RegList order;
+
+  for (uint32_t i = args.argumentEnd(); i < args.registerEnd(); i++) {
+    order.push_back(i);
+  }
+
+  std::stable_sort(order.begin(), order.end(), [&uses](uint32_t a, uint32_t b) {
+    return uses[a] > uses[b];
+  });
+
+  RegList new_index(args.registerEnd());
+  bool changed = false;
+
+  for (uint32_t i = 0; i < args.argumentEnd(); i++) {
+    new_index[i] = i;
+  }
+
+  for (size_t i = 0; i < order.size(); i++) {
+    new_index[order[i]] = static_cast<uint32_t>(args.argumentEnd() + i);
+    changed |= new_index[order[i]] != order[i];
+  }
+
+  if (!changed) {
+    return;
+  }
+
+  for (auto ins : byte_code->instructions()) {
+    for (auto &lit : ins->argument().literals()) {
+      if (lit.index() < args.registerEnd()) {
+        lit.setIndex(static_cast<LiteralIndex>(new_index[lit.index()]));
+      }
+    }
+
+    for (auto &reg : ins->readRegs()) {
+      reg = new_index[reg];
+    }
+
+    if (ins->hasFlag(InstFlags::WRITE_REG)) {
+      ins->writeReg() = new_index[ins->writeReg()];
+    }
+  }
+}
+
 void LivenessAnalysis::computeKillUe(BasicBlockList &bbs, InsList &insns) {
   for (auto ins : insns) {
 
     if (ins->hasFlag(InstFlags::READ_REG)) {
-      for (auto reg : ins->readRegs()) {
+      for (auto reg : uses(ins)) {
         if (ins->bb()->kill().find(reg) == ins->bb()->kill().end()) {
           ins->bb()->ue().insert(reg);
         }
@@ -77,8 +194,8 @@ void LivenessAnalysis::computeLiveOut(BasicBlock *bb) {
   RegSet new_liveout;
 
   for (auto succ : bb->successors()) {
-    // out[n] <- ue[n] U (out[n] intersection comp(kill[n]))
-    // Note: (out[n] - comp(kill[n])) == out[n] - (out[n] intersection kill[n])
+    // out[n] <- U ue[s] U (out[s] intersection comp(kill[s])) for s in succ(n)
+    // Note: (out[s] - comp(kill[s])) == out[s] - (out[s] intersection kill[s])
     RegSet difference;
 
     for (auto reg : succ->liveOut()) {
@@ -88,7 +205,7 @@ void LivenessAnalysis::computeLiveOut(BasicBlock *bb) {
     }
 
     new_liveout.insert(difference.begin(), difference.end());
-    new_liveout.insert(bb->ue().begin(), bb->ue().end());
+    new_liveout.insert(succ->ue().begin(), succ->ue().end());
   }
 
   bb->liveOut() = std::move(new_liveout);
@@ -141,6 +258,21 @@ void LivenessAnalysis::buildLiveRanges(Bytecode *byte_code,
 
   for (auto bb : bbs) {
     for (auto ins : bb->insns()) {
+      /* the operands are read before the result is written */
+      if (ins->hasFlag(InstFlags::READ_REG)) {
+        for (auto reg : uses(ins)) {
+          auto res = byte_code->liveRanges().find(reg);
+          if (res == byte_code->liveRanges().end()) {
+            byte_code->liveRanges().insert(
+                {reg,
+                 {new LiveInterval(bb->insns()[0]->offset(), ins->offset())}});
+            continue;
+          }
+
+          res->second.back()->setEnd(ins->offset());
+        }
+      }
+
       if (ins->hasFlag(InstFlags::WRITE_REG)) {
         uint32_t write_reg = ins->writeReg();
 
@@ -153,21 +285,29 @@ void LivenessAnalysis::buildLiveRanges(Bytecode *byte_code,
 
         res->second.back()->setEnd(ins->offset());
         res->second.push_back(new LiveInterval(ins->offset()));
+      }
+    }
+  }
+
+  /* a register live into the target of a backward edge is kept for the next
+     iteration, even after its last read in the loop body */
+  for (auto bb : bbs) {
+    if (bb->isEmpty()) {
+      continue;
+    }
+
+    uint32_t latch_end = bb->insns().back()->offset();
+
+    for (auto succ : bb->successors()) {
+      if (succ->isEmpty() || succ->insns().front()->offset() > latch_end) {
         continue;
       }
 
-      if (ins->hasFlag(InstFlags::READ_REG)) {
-        for (auto reg : ins->readRegs()) {
-          auto res = byte_code->liveRanges().find(reg);
-          if (res == byte_code->liveRanges().end()) {
-            byte_code->liveRanges().insert(
-                {reg,
-                 {new LiveInterval(bb->insns()[0]->offset(), ins->offset())}});
-            continue;
-          }
+      uint32_t header_start = succ->insns().front()->offset();
 
-          res->second.back()->setEnd(ins->offset());
-        }
+      for (auto reg : liveIn(succ)) {
+        byte_code->liveRanges()[reg].push_back(
+            new LiveInterval(header_start, latch_end));
       }
     }
   }
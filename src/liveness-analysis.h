@@ -28,6 +28,10 @@ public:
 
   virtual PassKind kind() { return PassKind::LIVENESS_ANALYSIS; }
 
+  static RegList uses(Ins *ins);
+  static RegSet liveIn(BasicBlock *bb);
+  static void orderRegisters(Optimizer *optimizer, Bytecode *byte_code);
+
 private:
   bool setsEqual(RegSet &a, RegSet &b);
   void computeKillUe(BasicBlockList &bbs, InsList &insns);
@@ -0,0 +1,142 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "loop-analysis.h"
+#include "basic-block.h"
+#include "dominator-analysis.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+LoopAnalysis::LoopAnalysis() : Pass() {}
+
+LoopAnalysis::~LoopAnalysis() {}
+
+bool LoopAnalysis::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::DOMINATOR_ANALYSIS));
+
+  reset(byte_code);
+  findLoops(byte_code);
+  computeNesting(byte_code);
+
+  for (auto loop : byte_code->loops()) {
+    LOG(*loop);
+  }
+
+  return true;
+}
+
+uint32_t LoopAnalysis::weight(uint32_t loop_depth) {
+  uint32_t weight = 1;
+  loop_depth = std::min<uint32_t>(loop_depth, LOOP_MAX_WEIGHTED_DEPTH);
+
+  while (loop_depth-- > 0) {
+    weight *= LOOP_ITERATION_WEIGHT;
+  }
+
+  return weight;
+}
+
+void LoopAnalysis::reset(Bytecode *byte_code) {
+  for (auto loop : byte_code->loops()) {
+    delete loop;
+  }
+
+  byte_code->loops().clear();
+
+  for (auto bb : byte_code->basicBlockList()) {
+    bb->loopDepth() = 0;
+  }
+}
+
+void LoopAnalysis::findLoops(Bytecode *byte_code) {
+  std::unordered_map<BasicBlock *, Loop *> headers;
+
+  for (auto bb : byte_code->basicBlockList()) {
+    for (auto succ : bb->successors()) {
+      // An edge whose target dominates its source is a back edge
+      if (!succ->isValid() || !DominatorAnalysis::dominatedBy(bb, succ)) {
+        continue;
+      }
+
+      auto res = headers.find(succ);
+      Loop *loop;
+
+      if (res == headers.end()) {
+        loop = new Loop(succ);
+        headers.insert({succ, loop});
+        byte_code->loops().push_back(loop);
+      } else {
+        loop = res->second;
+      }
+
+      loop->latches().push_back(bb);
+      collectBody(loop, bb);
+    }
+  }
+}
+
+void LoopAnalysis::collectBody(Loop *loop, BasicBlock *latch) {
+  BasicBlockList worklist{latch};
+  loop->blocks().insert(loop->header());
+
+  while (!worklist.empty()) {
+    BasicBlock *bb = worklist.back();
+    worklist.pop_back();
+
+    if (!loop->blocks().insert(bb).second) {
+      continue;
+    }
+
+    for (auto pred : bb->predecessors()) {
+      worklist.push_back(pred);
+    }
+  }
+}
+
+void LoopAnalysis::computeNesting(Bytecode *byte_code) {
+  LoopList &loops = byte_code->loops();
+
+  // Inner loops first, so the parent is the smallest enclosing loop
+  std::sort(loops.begin(), loops.end(), [](Loop *a, Loop *b) {
+    return a->blocks().size() < b->blocks().size();
+  });
+
+  for (auto iter = loops.begin(); iter != loops.end(); iter++) {
+    Loop *loop = *iter;
+
+    for (auto outer = std::next(iter); outer != loops.end(); outer++) {
+      if ((*outer)->contains(loop->header())) {
+        loop->parent() = *outer;
+        break;
+      }
+    }
+
+    for (auto bb : loop->blocks()) {
+      bb->loopDepth()++;
+    }
+  }
+}
+
+std::ostream &operator<<(std::ostream &os, const Loop &loop) {
+  os << "Loop header: " << loop.header()->id() << " depth: " << loop.depth()
+     << " blocks: [";
+
+  for (auto iter = loop.blocks_.begin(); iter != loop.blocks_.end(); iter++) {
+    os << (*iter)->id();
+
+    if (std::next(iter) != loop.blocks_.end()) {
+      os << ", ";
+    }
+  }
+
+  os << "]";
+  return os;
+}
+
+} // namespace optimizer
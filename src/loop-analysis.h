@@ -0,0 +1,73 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef LOOP_ANALYSIS_H
+#define LOOP_ANALYSIS_H
+
+#include "bytecode.h"
+#include "common.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+/* Estimated execution count of a loop body relative to its parent */
+#define LOOP_ITERATION_WEIGHT 8
+#define LOOP_MAX_WEIGHTED_DEPTH 4
+
+class LoopAnalysis : public Pass {
+public:
+  LoopAnalysis();
+  ~LoopAnalysis();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "LoopAnalysis"; }
+
+  virtual PassKind kind() { return PassKind::LOOP_ANALYSIS; }
+
+  static uint32_t weight(uint32_t loop_depth);
+
+private:
+  void reset(Bytecode *byte_code);
+  void findLoops(Bytecode *byte_code);
+  void collectBody(Loop *loop, BasicBlock *latch);
+  void computeNesting(Bytecode *byte_code);
+};
+
+class Loop {
+public:
+  Loop(BasicBlock *header) : header_(header), parent_(nullptr) {}
+
+  auto header() const { return header_; }
+  void setHeader(BasicBlock *header) { header_ = header; }
+  auto &latches() { return latches_; }
+  auto &blocks() { return blocks_; }
+  auto &parent() { return parent_; }
+
+  bool contains(BasicBlock *bb) const {
+    return blocks_.find(bb) != blocks_.end();
+  }
+
+  uint32_t depth() const {
+    return parent_ == nullptr ? 1 : parent_->depth() + 1;
+  }
+
+  friend std::ostream &operator<<(std::ostream &os, const Loop &loop);
+
+private:
+  BasicBlock *header_;
+  BasicBlockList latches_;
+  BasicBlockSet blocks_;
+  Loop *parent_;
+};
+
+} // namespace optimizer
+
+#endif // LOOP_ANALYSIS_H
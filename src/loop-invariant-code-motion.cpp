@@ -0,0 +1,384 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "loop-invariant-code-motion.h"
+#include "dominator-analysis.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+LoopInvariantCodeMotion::LoopInvariantCodeMotion()
+    : Pass(), preheader_(nullptr), preheader_jump_(nullptr),
+      preheader_last_(nullptr) {}
+
+LoopInvariantCodeMotion::~LoopInvariantCodeMotion() {}
+
+bool LoopInvariantCodeMotion::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::LOOP_ANALYSIS));
+
+  analyze(byte_code);
+
+  // Inner loops come first, so their hoisted code can leave the outer ones
+  for (auto loop : byte_code->loops()) {
+    hoist(byte_code, loop);
+  }
+
+  return true;
+}
+
+void LoopInvariantCodeMotion::analyze(Bytecode *byte_code) {
+  regions_.clear();
+
+  for (auto ins : byte_code->instructions()) {
+    if (!ins->hasFlag(InstFlags::DEAD) && ins->isTryContext()) {
+      regions_.push_back({ins->offset(), ins->jumpTarget()});
+    }
+  }
+
+  registers_.analyze(byte_code);
+}
+
+void LoopInvariantCodeMotion::hoist(Bytecode *byte_code, Loop *loop) {
+  BasicBlock *header = loop->header();
+
+  if (header->isEmpty()) {
+    return;
+  }
+
+  InsList body;
+  loop_writes_.clear();
+
+  for (auto bb : byte_code->basicBlockList()) {
+    if (!loop->contains(bb)) {
+      continue;
+    }
+
+    for (auto ins : bb->insns()) {
+      if (ins->hasFlag(InstFlags::DEAD)) {
+        break;
+      }
+
+      body.push_back(ins);
+
+      if (ins->hasFlag(InstFlags::WRITE_REG)) {
+        loop_writes_[ins->writeReg()]++;
+      }
+    }
+  }
+
+  int32_t header_offset = header->insns().front()->offset();
+  InsList invariants;
+  InsList defs;
+
+  for (auto ins : body) {
+    if (!sameRegions(ins->offset(), header_offset)) {
+      continue;
+    }
+
+    if (isInvariant(byte_code, ins)) {
+      invariants.push_back(ins);
+    } else if (isInvariantDef(byte_code, loop, ins)) {
+      defs.push_back(ins);
+    }
+  }
+
+  if ((invariants.empty() && defs.empty()) || !findPreheader(byte_code, loop)) {
+    return;
+  }
+
+  for (auto ins : defs) {
+    LOG("Hoist: " << *ins << " into: " << preheader_->id());
+
+    emit(byte_code,
+         Ins::create(byte_code, ins->opcode(), ins->argument().literals()));
+    byte_code->removeIns(ins);
+  }
+
+  /* the keys are taken before the new registers shift the constants */
+  using InvariantKey = std::pair<CBCOpcode, std::vector<LiteralIndex>>;
+  std::vector<InvariantKey> keys;
+
+  for (auto ins : invariants) {
+    std::vector<LiteralIndex> indices;
+
+    for (auto &literal : ins->argument().literals()) {
+      indices.push_back(literal.index());
+    }
+
+    keys.push_back({ins->opcode().CBCopcode(), indices});
+  }
+
+  std::map<InvariantKey, LiteralIndex> holders;
+
+  for (size_t i = 0; i < invariants.size(); i++) {
+    Ins *ins = invariants[i];
+    auto iter = holders.find(keys[i]);
+    LiteralIndex reg;
+
+    if (iter != holders.end()) {
+      reg = iter->second;
+    } else {
+      reg = byte_code->addRegister();
+      holders.insert({keys[i], reg});
+
+      LOG("Hoist: " << *ins << " into: " << preheader_->id()
+                    << " register: " << reg);
+
+      emit(byte_code,
+           Ins::create(byte_code, ins->opcode(), ins->argument().literals()));
+      emit(byte_code,
+           Ins::create(byte_code, Opcode(CBC_ASSIGN_SET_IDENT),
+                       {Literal(LiteralType::REGISTER, reg)}));
+    }
+
+    byte_code->replaceIns(
+        ins, Ins::create(byte_code, Opcode(CBC_PUSH_LITERAL),
+                         {Literal(LiteralType::REGISTER, reg)}));
+  }
+}
+
+/**
+ * Pure computation whose operands are not changed by the loop
+ */
+bool LoopInvariantCodeMotion::isInvariant(Bytecode *byte_code, Ins *ins) {
+  BytecodeArguments &args = byte_code->args();
+  OpcodeData data = ins->opcode().opcodeData();
+  GroupOpcode group = data.groupOpcode();
+
+  if (!RegisterAnalysis::isPrimitiveResult(group) || group == VM_OC_IN ||
+      group == VM_OC_INSTANCEOF || !data.isPutStack() || data.isPutIdent() ||
+      data.isPutBlock() || data.isPutReference()) {
+    return false;
+  }
+
+  if (data.operands() != OperandType::LITERAL &&
+      data.operands() != OperandType::LITERAL_LITERAL &&
+      group != VM_OC_TYPEOF_IDENT) {
+    return false;
+  }
+
+  for (auto &literal : ins->argument().literals()) {
+    LiteralIndex index = literal.index();
+
+    if (index < args.registerEnd()) {
+      if (registers_.isUntracked(index) || loop_writes_.count(index) != 0) {
+        return false;
+      }
+    } else if (index < args.identEnd() || index >= args.constLiteralEnd()) {
+      return false;
+    }
+
+    /* the hoisted code runs even if the loop body does not */
+    if (!RegisterAnalysis::isAlwaysPure(group) &&
+        registers_.kind(byte_code, literal) != ValueKind::PLAIN) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Constant load into a register which is only read inside the loop, after
+ * the load
+ */
+bool LoopInvariantCodeMotion::isInvariantDef(Bytecode *byte_code, Loop *loop,
+                                             Ins *ins) {
+  BytecodeArguments &args = byte_code->args();
+  OpcodeData data = ins->opcode().opcodeData();
+
+  if (data.groupOpcode() != VM_OC_ASSIGN ||
+      data.operands() != OperandType::LITERAL || data.isPutStack() ||
+      data.isPutBlock() || !ins->hasFlag(InstFlags::WRITE_REG)) {
+    return false;
+  }
+
+  LiteralIndex source = ins->argument().literals()[0].index();
+  uint32_t reg = ins->writeReg();
+
+  if (source < args.identEnd() || source >= args.constLiteralEnd() ||
+      registers_.isUntracked(reg) || loop_writes_[reg] != 1 ||
+      ins->bb()->insns().size() == 1) {
+    return false;
+  }
+
+  InsList &insns = ins->bb()->insns();
+  auto def = std::find(insns.begin(), insns.end(), ins);
+
+  for (auto other : byte_code->instructions()) {
+    if (other == ins || other->hasFlag(InstFlags::DEAD)) {
+      continue;
+    }
+
+    auto &reads = other->readRegs();
+
+    if (std::find(reads.begin(), reads.end(), reg) == reads.end()) {
+      continue;
+    }
+
+    BasicBlock *bb = other->bb();
+
+    if (bb == nullptr || !loop->contains(bb)) {
+      return false;
+    }
+
+    if (bb == ins->bb()) {
+      if (std::find(insns.begin(), def, other) != def) {
+        return false;
+      }
+    } else if (!DominatorAnalysis::dominatedBy(bb, ins->bb())) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * The only block entering the loop from outside becomes the preheader if it
+ * always continues with the header. If it falls through into the header on
+ * one edge of a conditional branch, a new block is placed on that edge.
+ */
+bool LoopInvariantCodeMotion::findPreheader(Bytecode *byte_code, Loop *loop) {
+  BasicBlock *header = loop->header();
+  BasicBlock *entry = nullptr;
+
+  for (auto pred : header->predecessors()) {
+    if (loop->contains(pred)) {
+      continue;
+    }
+
+    if (entry != nullptr && entry != pred) {
+      return false;
+    }
+
+    entry = pred;
+  }
+
+  if (entry == nullptr || !entry->isValid() || entry->isEmpty()) {
+    return false;
+  }
+
+  Ins *jump = entry->terminator();
+  int32_t header_offset = header->insns().front()->offset();
+
+  if (!sameRegions((jump != nullptr ? jump : entry->insns().back())->offset(),
+                   header_offset)) {
+    return false;
+  }
+
+  if (entry->successors().size() == 1) {
+    GroupOpcode last =
+        entry->insns().back()->opcode().opcodeData().groupOpcode();
+
+    /* the fall through edge of a return or throw is never taken */
+    if (jump != nullptr
+            ? jump->opcode().opcodeData().groupOpcode() != VM_OC_JUMP
+            : last == VM_OC_RETURN || last == VM_OC_THROW) {
+      return false;
+    }
+
+    preheader_ = entry;
+    preheader_jump_ = jump;
+    preheader_last_ = entry->insns().back();
+    return true;
+  }
+
+  if (jump == nullptr || !jump->isConditionalJump() ||
+      jump != entry->insns().back() || jump->jumpTarget() == header_offset) {
+    return false;
+  }
+
+  if (byte_code->next(jump) != header->insns().front()) {
+    return false;
+  }
+
+  createPreheader(byte_code, loop, entry);
+  return true;
+}
+
+void LoopInvariantCodeMotion::createPreheader(Bytecode *byte_code, Loop *loop,
+                                              BasicBlock *entry) {
+  BasicBlockList &bbs = byte_code->basicBlockList();
+  BasicBlock *header = loop->header();
+  BasicBlockID id = 0;
+
+  for (auto bb : bbs) {
+    id = std::max(id, bb->id() + 1);
+  }
+
+  BasicBlock *pre = BasicBlock::create(id);
+
+  /* keep the edge order of the conditional branch */
+  *std::find(entry->successors().begin(), entry->successors().end(), header) =
+      pre;
+  *std::find(header->predecessors().begin(), header->predecessors().end(),
+             entry) = pre;
+  pre->predecessors().push_back(entry);
+  pre->successors().push_back(header);
+
+  bbs.insert(std::next(std::find(bbs.begin(), bbs.end(), entry)), pre);
+
+  for (auto bb : bbs) {
+    if (DominatorAnalysis::dominatedBy(bb, header)) {
+      bb->dominators().push_back(pre);
+    }
+  }
+
+  pre->dominators() = entry->dominators();
+  pre->dominators().push_back(pre);
+  pre->idom() = entry;
+  header->idom() = pre;
+
+  for (auto outer : byte_code->loops()) {
+    if (outer->contains(entry) && outer->contains(header)) {
+      outer->blocks().insert(pre);
+      pre->loopDepth()++;
+    }
+  }
+
+  preheader_ = pre;
+  preheader_jump_ = nullptr;
+  preheader_last_ = entry->insns().back();
+}
+
+/**
+ * Append an instruction to the preheader, in front of its jump
+ */
+void LoopInvariantCodeMotion::emit(Bytecode *byte_code, Ins *ins) {
+  if (preheader_jump_ != nullptr) {
+    byte_code->insertInsBefore(preheader_jump_, ins);
+  } else {
+    byte_code->insertInsAfter(preheader_last_, ins);
+    preheader_last_ = ins;
+  }
+
+  if (ins->bb() != preheader_) {
+    InsList &insns = ins->bb()->insns();
+    insns.erase(std::find(insns.begin(), insns.end(), ins));
+    preheader_->addIns(ins);
+  }
+}
+
+/**
+ * Both offsets are covered by the same try contexts
+ */
+bool LoopInvariantCodeMotion::sameRegions(int32_t from, int32_t to) {
+  for (auto &region : regions_) {
+    bool from_inside = from >= region.first && from < region.second;
+    bool to_inside = to >= region.first && to < region.second;
+
+    if (from_inside != to_inside) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace optimizer
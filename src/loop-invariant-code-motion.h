@@ -0,0 +1,65 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef LOOP_INVARIANT_CODE_MOTION_H
+#define LOOP_INVARIANT_CODE_MOTION_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "loop-analysis.h"
+#include "pass.h"
+#include "register-analysis.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+/**
+ * Offset range covered by a try, catch or finally context
+ */
+using TryRegion = std::pair<int32_t, int32_t>;
+
+class LoopInvariantCodeMotion : public Pass {
+public:
+  LoopInvariantCodeMotion();
+  ~LoopInvariantCodeMotion();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "LoopInvariantCodeMotion"; }
+
+  virtual PassKind kind() { return PassKind::LOOP_INVARIANT_CODE_MOTION; }
+
+private:
+  void analyze(Bytecode *byte_code);
+
+  void hoist(Bytecode *byte_code, Loop *loop);
+  bool isInvariant(Bytecode *byte_code, Ins *ins);
+  bool isInvariantDef(Bytecode *byte_code, Loop *loop, Ins *ins);
+  bool findPreheader(Bytecode *byte_code, Loop *loop);
+  void createPreheader(Bytecode *byte_code, Loop *loop, BasicBlock *entry);
+  void emit(Bytecode *byte_code, Ins *ins);
+  bool sameRegions(int32_t from, int32_t to);
+
+  std::vector<TryRegion> regions_;
+  RegisterAnalysis registers_;
+  /* number of writes of each register in the current loop */
+  std::unordered_map<uint32_t, uint32_t> loop_writes_;
+
+  BasicBlock *preheader_;
+  /* hoisted instructions are placed before this jump, if any */
+  Ins *preheader_jump_;
+  /* otherwise after this instruction */
+  Ins *preheader_last_;
+};
+
+} // namespace optimizer
+
+#endif // LOOP_INVARIANT_CODE_MOTION_H
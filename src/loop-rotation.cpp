@@ -0,0 +1,146 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "loop-rotation.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+LoopRotation::LoopRotation() : Pass() {}
+
+LoopRotation::~LoopRotation() {}
+
+bool LoopRotation::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::LOOP_ANALYSIS));
+
+  /* the duplicated condition could throw into a different handler */
+  for (auto ins : byte_code->instructions()) {
+    if (ins->isTryContext()) {
+      return true;
+    }
+  }
+
+  for (auto loop : byte_code->loops()) {
+    rotate(byte_code, loop);
+  }
+
+  return true;
+}
+
+/**
+ * Rewrite
+ *
+ *   header: cond; BRANCH_IF_FALSE exit
+ *   body:   ...; JUMP_BACKWARD header
+ *   exit:
+ *
+ * into
+ *
+ *   header: cond; BRANCH_IF_FALSE exit
+ *   body:   ...; cond; BRANCH_IF_TRUE_BACKWARD body
+ *   exit:
+ *
+ * The header is only executed on entry and the loop is headed by the body.
+ */
+bool LoopRotation::rotate(Bytecode *byte_code, Loop *loop) {
+  BasicBlock *header = loop->header();
+
+  if (loop->latches().size() != 1 || header->isEmpty()) {
+    return false;
+  }
+
+  BasicBlock *latch = loop->latches().front();
+  Ins *jump = latch->terminator();
+
+  if (latch == header || jump == nullptr ||
+      jump->opcode().opcodeData().groupOpcode() != VM_OC_JUMP ||
+      byte_code->insAt(jump->jumpTarget()) != header->insns().front()) {
+    return false;
+  }
+
+  Ins *branch = header->terminator();
+
+  if (branch == nullptr || branch != header->insns().back() ||
+      branch->opcode().opcodeData().isBackwardBrach()) {
+    return false;
+  }
+
+  CBCOpcode rotated;
+
+  switch (branch->opcode().opcodeData().groupOpcode()) {
+  case VM_OC_BRANCH_IF_TRUE: {
+    rotated = CBC_BRANCH_IF_FALSE_BACKWARD;
+    break;
+  }
+  case VM_OC_BRANCH_IF_FALSE: {
+    rotated = CBC_BRANCH_IF_TRUE_BACKWARD;
+    break;
+  }
+  default: {
+    return false;
+  }
+  }
+
+  /* the loop is left by falling through the new branch */
+  Ins *exit_ins = byte_code->insAt(branch->jumpTarget());
+  Ins *body_ins = byte_code->next(branch);
+
+  if (exit_ins == nullptr || body_ins == nullptr ||
+      exit_ins != byte_code->next(jump)) {
+    return false;
+  }
+
+  BasicBlock *exit = exit_ins->bb();
+  BasicBlock *body = body_ins->bb();
+
+  if (exit == nullptr || body == nullptr || loop->contains(exit) ||
+      !loop->contains(body) || body == header) {
+    return false;
+  }
+
+  InsList condition(header->insns().begin(), std::prev(header->insns().end()));
+
+  if (condition.size() > LOOP_ROTATION_MAX_CONDITION_SIZE) {
+    return false;
+  }
+
+  for (auto ins : condition) {
+    if (!isDuplicable(ins)) {
+      return false;
+    }
+  }
+
+  LOG("Rotate loop: " << header->id() << " new header: " << body->id());
+
+  /* jumps to the latch branch (e.g. continue) evaluate the copied condition */
+  for (auto ins : condition) {
+    byte_code->insertInsBefore(jump, ins->clone());
+  }
+
+  Ins *back = Ins::create(byte_code, Opcode(rotated), {});
+  back->argument().setBranchOffset(static_cast<int32_t>(body_ins->offset()) -
+                                   static_cast<int32_t>(jump->offset()));
+  byte_code->replaceIns(jump, back);
+
+  latch->removeSuccessor(header->id());
+  latch->addSuccessor(exit);
+  latch->addSuccessor(body);
+
+  loop->blocks().erase(header);
+  loop->setHeader(body);
+  header->loopDepth()--;
+
+  return true;
+}
+
+bool LoopRotation::isDuplicable(Ins *ins) {
+  return !ins->hasFlag(InstFlags::DEAD) && !ins->isJump() &&
+         ins->argument().type() != OperandType::BRANCH;
+}
+
+} // namespace optimizer
@@ -0,0 +1,45 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef LOOP_ROTATION_H
+#define LOOP_ROTATION_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "loop-analysis.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+/* Largest condition block, without its branch, which is duplicated */
+#define LOOP_ROTATION_MAX_CONDITION_SIZE 8
+
+class LoopRotation : public Pass {
+public:
+  LoopRotation();
+  ~LoopRotation();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "LoopRotation"; }
+
+  virtual PassKind kind() { return PassKind::LOOP_ROTATION; }
+
+private:
+  bool rotate(Bytecode *byte_code, Loop *loop);
+
+  static bool isDuplicable(Ins *ins);
+};
+
+} // namespace optimizer
+
+#endif // LOOP_ROTATION_H
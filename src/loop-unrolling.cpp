@@ -0,0 +1,301 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "loop-unrolling.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+LoopUnrolling::LoopUnrolling(uint32_t max_trip_count, uint32_t max_size)
+    : Pass(), max_trip_count_(max_trip_count), max_size_(max_size) {}
+
+LoopUnrolling::~LoopUnrolling() {}
+
+bool LoopUnrolling::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::LOOP_ANALYSIS));
+
+  if (max_trip_count_ == 0 || max_size_ == 0 ||
+      !evaluator_.prepare(byte_code)) {
+    return true;
+  }
+
+  /* unrolled loops are removed from the list */
+  LoopList loops = byte_code->loops();
+
+  for (auto loop : loops) {
+    unroll(byte_code, loop);
+  }
+
+  return true;
+}
+
+/**
+ * Fully unroll a loop whose exit test is decided by the known initial
+ * register values. The parser emits 'for' and 'while' loops as
+ *
+ *   entry:  ...; JUMP_FORWARD header
+ *   body:   ...
+ *   header: cond; BRANCH_IF_TRUE_BACKWARD body
+ *
+ * and loop rotation leaves single block loops as
+ *
+ *   header: ...; cond; BRANCH_IF_TRUE_BACKWARD header
+ *
+ * The exit test of every copy is replaced by a pop, the following constant
+ * propagation folds the induction registers into the copies.
+ */
+bool LoopUnrolling::unroll(Bytecode *byte_code, Loop *loop) {
+  BasicBlock *header = loop->header();
+
+  if (loop->latches().size() != 1 || header->isEmpty()) {
+    return false;
+  }
+
+  BasicBlock *latch = loop->latches().front();
+  BasicBlock *body;
+
+  if (loop->blocks().size() == 1) {
+    body = header;
+  } else if (loop->blocks().size() == 2 && latch != header) {
+    body = latch;
+  } else {
+    return false;
+  }
+
+  Ins *branch = header->insns().back();
+  OpcodeData data = branch->opcode().opcodeData();
+
+  if (!branch->isConditionalJump() || !data.isBackwardBrach() ||
+      (data.groupOpcode() != VM_OC_BRANCH_IF_TRUE &&
+       data.groupOpcode() != VM_OC_BRANCH_IF_FALSE) ||
+      byte_code->insAt(branch->jumpTarget()) != body->insns().front()) {
+    return false;
+  }
+
+  Ins *exit_ins = byte_code->next(branch);
+
+  if (exit_ins == nullptr || exit_ins->bb() == nullptr ||
+      loop->contains(exit_ins->bb()) || !isStraightLine(header, branch) ||
+      !isStraightLine(body, branch)) {
+    return false;
+  }
+
+  BasicBlock *entry = nullptr;
+
+  for (auto pred : header->predecessors()) {
+    if (loop->contains(pred)) {
+      continue;
+    }
+
+    if (entry != nullptr && entry != pred) {
+      return false;
+    }
+
+    entry = pred;
+  }
+
+  if (entry == nullptr || !entry->isValid() || entry->isEmpty()) {
+    return false;
+  }
+
+  Ins *jump = entry->insns().back();
+
+  if (body != header &&
+      (jump->hasFlag(InstFlags::DEAD) ||
+       jump->opcode().opcodeData().groupOpcode() != VM_OC_JUMP ||
+       byte_code->insAt(jump->jumpTarget()) != header->insns().front() ||
+       byte_code->next(jump) != body->insns().front() ||
+       byte_code->next(body->insns().back()) != header->insns().front())) {
+    return false;
+  }
+
+  uint32_t count;
+
+  if (!tripCount(byte_code, loop, entry, branch, count) || count == 0) {
+    return false;
+  }
+
+  size_t size = header->insns().size();
+
+  if (body != header) {
+    size += body->insns().size();
+  }
+
+  if (size * count > max_size_) {
+    return false;
+  }
+
+  LOG("Unroll loop: " << header->id() << " iterations: " << count);
+
+  if (body != header) {
+    /* the jump into the loop becomes the first evaluation of the test */
+    for (auto ins : header->insns()) {
+      byte_code->insertInsBefore(
+          jump, ins == branch ? Ins::create(byte_code, Opcode(CBC_POP), {})
+                              : ins->clone());
+    }
+
+    byte_code->removeIns(jump);
+  }
+
+  byte_code->replaceIns(branch, Ins::create(byte_code, Opcode(CBC_POP), {}));
+
+  InsList iteration;
+
+  if (body != header) {
+    iteration = body->insns();
+  }
+
+  iteration.insert(iteration.end(), header->insns().begin(),
+                   header->insns().end());
+
+  Ins *anchor = header->insns().back();
+
+  for (uint32_t i = 1; i < count; i++) {
+    for (auto ins : iteration) {
+      Ins *copy = ins->clone();
+      byte_code->insertInsAfter(anchor, copy);
+      anchor = copy;
+    }
+  }
+
+  if (body != header) {
+    entry->removeSuccessor(header->id());
+    entry->addSuccessor(body);
+  }
+
+  header->removeSuccessor(body->id());
+  removeLoop(byte_code, loop);
+
+  return true;
+}
+
+/**
+ * Number of times the body runs, evaluated on the register values known when
+ * the loop is entered
+ */
+bool LoopUnrolling::tripCount(Bytecode *byte_code, Loop *loop,
+                              BasicBlock *entry, Ins *branch,
+                              uint32_t &count) {
+  BasicBlock *header = loop->header();
+  BasicBlock *body = byte_code->insAt(branch->jumpTarget())->bb();
+  bool continue_if =
+      branch->opcode().opcodeData().groupOpcode() == VM_OC_BRANCH_IF_TRUE;
+  ConstantState state = entryState(byte_code, entry);
+
+  count = 0;
+
+  while (true) {
+    if (body == header && ++count > max_trip_count_) {
+      return false;
+    }
+
+    for (auto ins : header->insns()) {
+      if (ins != branch) {
+        evaluator_.evaluate(byte_code, ins, state);
+      }
+    }
+
+    ConstantValue condition = state.pop();
+
+    if (!condition.isKnown()) {
+      return false;
+    }
+
+    if (condition.toBoolean() != continue_if) {
+      return true;
+    }
+
+    if (body == header) {
+      continue;
+    }
+
+    if (++count > max_trip_count_) {
+      return false;
+    }
+
+    for (auto ins : body->insns()) {
+      evaluator_.evaluate(byte_code, ins, state);
+    }
+  }
+}
+
+/**
+ * Register values at the end of the entry block, evaluated along the chain of
+ * single predecessor blocks which leads to it
+ */
+ConstantState LoopUnrolling::entryState(Bytecode *byte_code,
+                                        BasicBlock *entry) {
+  BasicBlockList chain = {entry};
+
+  while (chain.size() < LOOP_UNROLL_MAX_ENTRY_CHAIN &&
+         chain.front()->predecessors().size() == 1) {
+    BasicBlock *pred = chain.front()->predecessors().front();
+
+    if (!pred->isValid() ||
+        std::find(chain.begin(), chain.end(), pred) != chain.end()) {
+      break;
+    }
+
+    chain.insert(chain.begin(), pred);
+  }
+
+  ConstantState state;
+  state.registers.resize(byte_code->args().registerEnd());
+
+  for (auto bb : chain) {
+    for (auto ins : bb->insns()) {
+      if (ins->hasFlag(InstFlags::DEAD)) {
+        break;
+      }
+
+      if (ins->isJump()) {
+        state.stack.clear();
+        break;
+      }
+
+      evaluator_.evaluate(byte_code, ins, state);
+    }
+  }
+
+  return state;
+}
+
+void LoopUnrolling::removeLoop(Bytecode *byte_code, Loop *loop) {
+  LoopList &loops = byte_code->loops();
+
+  for (auto bb : loop->blocks()) {
+    bb->loopDepth()--;
+  }
+
+  for (auto other : loops) {
+    if (other->parent() == loop) {
+      other->parent() = loop->parent();
+    }
+  }
+
+  loops.erase(std::find(loops.begin(), loops.end(), loop));
+  delete loop;
+}
+
+bool LoopUnrolling::isStraightLine(BasicBlock *bb, Ins *branch) {
+  for (auto ins : bb->insns()) {
+    if (ins == branch) {
+      continue;
+    }
+
+    if (ins->hasFlag(InstFlags::DEAD) || ins->isJump() ||
+        ins->argument().type() == OperandType::BRANCH) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+} // namespace optimizer
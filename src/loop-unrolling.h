@@ -0,0 +1,67 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef LOOP_UNROLLING_H
+#define LOOP_UNROLLING_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "constant-propagation.h"
+#include "inst.h"
+#include "loop-analysis.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+/* Largest number of iterations which is unrolled */
+#ifndef LOOP_UNROLL_MAX_TRIP_COUNT
+#define LOOP_UNROLL_MAX_TRIP_COUNT 8
+#endif /* !LOOP_UNROLL_MAX_TRIP_COUNT */
+
+/* Largest number of instructions an unrolled loop may grow to, 0 disables
+ * unrolling */
+#ifndef LOOP_UNROLL_MAX_SIZE
+#define LOOP_UNROLL_MAX_SIZE 64
+#endif /* !LOOP_UNROLL_MAX_SIZE */
+
+/* Number of blocks walked back from the loop to find the initial values */
+#define LOOP_UNROLL_MAX_ENTRY_CHAIN 4
+
+class LoopUnrolling : public Pass {
+public:
+  LoopUnrolling(uint32_t max_trip_count = LOOP_UNROLL_MAX_TRIP_COUNT,
+                uint32_t max_size = LOOP_UNROLL_MAX_SIZE);
+  ~LoopUnrolling();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "LoopUnrolling"; }
+
+  virtual PassKind kind() { return PassKind::LOOP_UNROLLING; }
+
+private:
+  bool unroll(Bytecode *byte_code, Loop *loop);
+  bool tripCount(Bytecode *byte_code, Loop *loop, BasicBlock *entry,
+                 Ins *branch, uint32_t &count);
+  ConstantState entryState(Bytecode *byte_code, BasicBlock *entry);
+  void removeLoop(Bytecode *byte_code, Loop *loop);
+
+  static bool isStraightLine(BasicBlock *bb, Ins *branch);
+
+  uint32_t max_trip_count_;
+  uint32_t max_size_;
+  /* evaluates the loop iterations on the known register values */
+  ConstantPropagation evaluator_;
+};
+
+} // namespace optimizer
+
+#endif // LOOP_UNROLLING_H
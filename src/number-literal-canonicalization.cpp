@@ -0,0 +1,168 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "number-literal-canonicalization.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+NumberLiteralCanonicalization::NumberLiteralCanonicalization() : Pass() {}
+
+NumberLiteralCanonicalization::~NumberLiteralCanonicalization() {}
+
+/**
+ * The pool entries which are no longer referenced are dropped by the
+ * literal pool compaction
+ */
+bool NumberLiteralCanonicalization::run(Optimizer *optimizer,
+                                        Bytecode *byte_code) {
+  mergeDuplicates(byte_code);
+
+  InsList &insns = byte_code->instructions();
+
+  for (size_t i = 0; i < insns.size(); i++) {
+    Ins *ins = canonicalize(byte_code, insns[i]);
+
+    if (ins != nullptr) {
+      LOG("Canonicalize number literal: " << *insns[i] << " to: " << *ins);
+      byte_code->replaceIns(insns[i], ins);
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Every number constant is referred by the first pool entry of its value
+ */
+void NumberLiteralCanonicalization::mergeDuplicates(Bytecode *byte_code) {
+  BytecodeArguments &args = byte_code->args();
+  LiteralPool &pool = byte_code->literalPool();
+  std::unordered_map<LiteralIndex, LiteralIndex> canonical;
+
+  for (LiteralIndex i = args.identEnd(); i < args.constLiteralEnd(); i++) {
+    if (!ecma_is_value_number(pool.at(i))) {
+      continue;
+    }
+
+    for (LiteralIndex j = args.identEnd(); j < i; j++) {
+      if (isSameNumber(pool.at(i), pool.at(j))) {
+        LOG("Merge number literal: " << i << " into: " << j);
+        canonical[i] = j;
+        break;
+      }
+    }
+  }
+
+  if (canonical.empty()) {
+    return;
+  }
+
+  for (auto ins : byte_code->instructions()) {
+    for (auto &literal : ins->argument().literals()) {
+      auto iter = canonical.find(literal.index());
+
+      if (iter != canonical.end()) {
+        literal.setIndex(iter->second);
+      }
+    }
+  }
+}
+
+/**
+ * Pushes of small integer constants use the immediate forms, the literals
+ * of the other instructions are kept as they save an instruction
+ */
+Ins *NumberLiteralCanonicalization::canonicalize(Bytecode *byte_code,
+                                                 Ins *ins) {
+  auto &literals = ins->argument().literals();
+  int32_t number;
+
+  if (ins->opcode().is(CBC_PUSH_LITERAL) &&
+      isSmallInteger(byte_code, literals[0], number)) {
+    return immediate(byte_code, number, {});
+  }
+
+  if (ins->opcode().is(CBC_PUSH_TWO_LITERALS) &&
+      isSmallInteger(byte_code, literals[1], number)) {
+    return immediate(byte_code, number, {literals[0]});
+  }
+
+  return nullptr;
+}
+
+bool NumberLiteralCanonicalization::isSmallInteger(Bytecode *byte_code,
+                                                   Literal &literal,
+                                                   int32_t &number) {
+  BytecodeArguments &args = byte_code->args();
+
+  if (literal.index() < args.identEnd() ||
+      literal.index() >= args.constLiteralEnd()) {
+    return false;
+  }
+
+  ecma_value_t value = byte_code->literalPool().at(literal.index());
+
+  if (!ecma_is_value_integer_number(value)) {
+    return false;
+  }
+
+  number = ecma_get_integer_from_value(value);
+  return number >= -(UINT8_MAX + 1) && number <= UINT8_MAX + 1;
+}
+
+/**
+ * Positive and negative zeros are different constants, NaNs are never merged
+ */
+bool NumberLiteralCanonicalization::isSameNumber(ecma_value_t left,
+                                                 ecma_value_t right) {
+  if (left == right) {
+    return true;
+  }
+
+  if (!ecma_is_value_number(left) || !ecma_is_value_number(right)) {
+    return false;
+  }
+
+  ecma_number_t left_number = ecma_get_number_from_value(left);
+  ecma_number_t right_number = ecma_get_number_from_value(right);
+
+  return left_number == right_number &&
+         std::signbit(left_number) == std::signbit(right_number);
+}
+
+/**
+ * Push of the number, which follows the push of 'literals' if it is not empty
+ */
+Ins *NumberLiteralCanonicalization::immediate(
+    Bytecode *byte_code, int32_t number, const std::vector<Literal> &literals) {
+  bool after_literal = !literals.empty();
+
+  if (number == 0) {
+    return Ins::create(byte_code,
+                       Opcode(after_literal ? CBC_PUSH_LITERAL_PUSH_NUMBER_0
+                                            : CBC_PUSH_NUMBER_0),
+                       literals);
+  }
+
+  CBCOpcode opcode;
+
+  if (number > 0) {
+    opcode = after_literal ? CBC_PUSH_LITERAL_PUSH_NUMBER_POS_BYTE
+                           : CBC_PUSH_NUMBER_POS_BYTE;
+  } else {
+    opcode = after_literal ? CBC_PUSH_LITERAL_PUSH_NUMBER_NEG_BYTE
+                           : CBC_PUSH_NUMBER_NEG_BYTE;
+  }
+
+  Ins *ins = Ins::create(byte_code, Opcode(opcode), literals);
+  ins->argument().setByteArg(static_cast<uint8_t>(std::abs(number) - 1));
+  return ins;
+}
+
+} // namespace optimizer
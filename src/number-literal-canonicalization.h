@@ -0,0 +1,45 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef NUMBER_LITERAL_CANONICALIZATION_H
+#define NUMBER_LITERAL_CANONICALIZATION_H
+
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class NumberLiteralCanonicalization : public Pass {
+public:
+  NumberLiteralCanonicalization();
+  ~NumberLiteralCanonicalization();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "NumberLiteralCanonicalization"; }
+
+  virtual PassKind kind() { return PassKind::NUMBER_LITERAL_CANONICALIZATION; }
+
+private:
+  void mergeDuplicates(Bytecode *byte_code);
+  Ins *canonicalize(Bytecode *byte_code, Ins *ins);
+
+  static bool isSmallInteger(Bytecode *byte_code, Literal &literal,
+                             int32_t &number);
+  static bool isSameNumber(ecma_value_t left, ecma_value_t right);
+  static Ins *immediate(Bytecode *byte_code, int32_t number,
+                        const std::vector<Literal> &literals);
+};
+
+} // namespace optimizer
+
+#endif // NUMBER_LITERAL_CANONICALIZATION_H
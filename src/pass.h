@@ -17,11 +17,33 @@ namespace optimizer {
 class Optimizer;
 
 enum PassKind {
-  NONE,
-  CONTROL_FLOW_ANALYSIS,
-  DOMINATOR_ANALYSIS,
-  LIVENESS_ANALYSIS,
-  REGALLOC_LINEAR_SCAN,
+  NONE = 0,
+  CONTROL_FLOW_ANALYSIS = (1 << 0),
+  DOMINATOR_ANALYSIS = (1 << 1),
+  LIVENESS_ANALYSIS = (1 << 2),
+  REGALLOC_LINEAR_SCAN = (1 << 3),
+  LOOP_ANALYSIS = (1 << 4),
+  LITERAL_POOL_REORDER = (1 << 5),
+  LITERAL_POOL_COMPACTION = (1 << 6),
+  PEEPHOLE = (1 << 7),
+  UNUSED_RESULT_ELIMINATION = (1 << 8),
+  CONSTANT_PROPAGATION = (1 << 9),
+  GLOBAL_VALUE_NUMBERING = (1 << 10),
+  LOOP_INVARIANT_CODE_MOTION = (1 << 11),
+  LOOP_ROTATION = (1 << 12),
+  LOOP_UNROLLING = (1 << 13),
+  BLOCK_LAYOUT = (1 << 14),
+  BLOCK_MERGING = (1 << 15),
+  FUNCTION_INLINING = (1 << 16),
+  IDENT_PROMOTION = (1 << 17),
+  ARGUMENTS_ELIMINATION = (1 << 18),
+  TDZ_ELIMINATION = (1 << 19),
+  BLOCK_CONTEXT_ELIMINATION = (1 << 20),
+  REGALLOC_GRAPH_COLORING = (1 << 21),
+  LINE_INFO_MINIMIZATION = (1 << 22),
+  BRANCH_SIMPLIFICATION = (1 << 23),
+  NUMBER_LITERAL_CANONICALIZATION = (1 << 24),
+  STRING_CONCAT_FOLDING = (1 << 25),
 };
 
 class Pass {
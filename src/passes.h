@@ -9,9 +9,31 @@
 #ifndef PASSES_H
 #define PASSES_H
 
+#include "arguments-elimination.h"
+#include "block-context-elimination.h"
+#include "block-layout.h"
+#include "block-merging.h"
+#include "branch-simplification.h"
+#include "constant-propagation.h"
 #include "control-flow-analysis.h"
 #include "dominator-analysis.h"
+#include "function-inlining.h"
+#include "global-value-numbering.h"
+#include "ident-promotion.h"
+#include "line-info-minimization.h"
+#include "literal-pool-compaction.h"
+#include "literal-pool-reorder.h"
 #include "liveness-analysis.h"
+#include "loop-analysis.h"
+#include "loop-invariant-code-motion.h"
+#include "loop-rotation.h"
+#include "loop-unrolling.h"
+#include "number-literal-canonicalization.h"
+#include "peephole.h"
+#include "regalloc-graph-coloring.h"
 #include "regalloc-linear-scan.h"
+#include "string-concat-folding.h"
+#include "tdz-elimination.h"
+#include "unused-result-elimination.h"
 
 #endif // PASSES_H
@@ -0,0 +1,516 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "peephole.h"
+#include "basic-block.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+namespace {
+
+#define CBC_OPCODE(arg1, arg2, arg3, arg4) arg4,
+constexpr uint16_t peephole_decode_table[] = {CBC_OPCODE_LIST
+                                                  CBC_EXT_OPCODE_LIST};
+#undef CBC_OPCODE
+
+constexpr size_t peephole_opcode_count =
+    sizeof(peephole_decode_table) / sizeof(peephole_decode_table[0]);
+
+constexpr PeepholeMatch op(CBCOpcode opcode,
+                           PeepholeOperand operand = PeepholeOperand::ANY) {
+  return {opcode, operand};
+}
+
+constexpr PeepholeLiteral lit(uint8_t ins, uint8_t index = 0) {
+  return {ins, index};
+}
+
+constexpr PeepholeReplacement
+emit(CBCOpcode opcode, std::initializer_list<PeepholeLiteral> literals = {},
+     uint8_t byte_arg = PEEPHOLE_NO_SOURCE,
+     uint8_t branch = PEEPHOLE_NO_SOURCE) {
+  PeepholeReplacement replacement{opcode, 0, {}, byte_arg, branch};
+
+  for (auto literal : literals) {
+    replacement.literals[replacement.literal_count++] = literal;
+  }
+
+  return replacement;
+}
+
+constexpr PeepholePattern
+pattern(const char *name, std::initializer_list<PeepholeMatch> match,
+        std::initializer_list<PeepholeReplacement> replacement,
+        PeepholeGuard guard = nullptr) {
+  PeepholePattern result{name, 0, {}, 0, {}, guard};
+
+  for (auto item : match) {
+    result.match[result.length++] = item;
+  }
+
+  for (auto item : replacement) {
+    result.replacement[result.replacement_count++] = item;
+  }
+
+  return result;
+}
+
+/* operands pushed right before an unary operation */
+#define PEEPHOLE_UNARY_PATTERNS(name)                                          \
+  pattern(#name "-literal", {op(CBC_PUSH_LITERAL), op(name)},                  \
+          {emit(name##_LITERAL, {lit(0)})})
+
+/* operands pushed right before a binary operation */
+#define PEEPHOLE_BINARY_PATTERNS(name)                                         \
+  pattern(#name "-two-literals", {op(CBC_PUSH_TWO_LITERALS), op(name)},        \
+          {emit(name##_TWO_LITERALS, {lit(0, 0), lit(0, 1)})}),                \
+      pattern(#name "-three-literals",                                         \
+              {op(CBC_PUSH_THREE_LITERALS), op(name)},                         \
+              {emit(CBC_PUSH_LITERAL, {lit(0, 0)}),                            \
+               emit(name##_TWO_LITERALS, {lit(0, 1), lit(0, 2)})}),            \
+      pattern(#name "-right-literal", {op(CBC_PUSH_LITERAL), op(name)},        \
+              {emit(name##_RIGHT_LITERAL, {lit(0)})})
+
+/* operands pushed right before they are stored into an ident */
+#define PEEPHOLE_SET_IDENT_PATTERNS(name, literal_name)                        \
+  pattern(#name "-literal", {op(CBC_PUSH_LITERAL), op(name)},                  \
+          {emit(literal_name, {lit(0), lit(1)})}),                             \
+      pattern(#name "-two-literals", {op(CBC_PUSH_TWO_LITERALS), op(name)},    \
+              {emit(CBC_PUSH_LITERAL, {lit(0, 0)}),                            \
+               emit(literal_name, {lit(0, 1), lit(1)})}),                      \
+      pattern(#name "-three-literals",                                         \
+              {op(CBC_PUSH_THREE_LITERALS), op(name)},                         \
+              {emit(CBC_PUSH_TWO_LITERALS, {lit(0, 0), lit(0, 1)}),            \
+               emit(literal_name, {lit(0, 2), lit(1)})})
+
+/**
+ * The literal pushed by the second instruction is the register which
+ * was assigned by the first one
+ */
+bool reloadsRegister(Bytecode *byte_code, Ins **window) {
+  LiteralIndex destination = window[0]->argument().literals().back().index();
+
+  return destination < byte_code->args().registerEnd() &&
+         destination == window[1]->argument().literals()[0].index();
+}
+
+/**
+ * Rewrite rules, dispatched on the opcode of their first instruction.
+ * Branches are matched and emitted in their one byte offset form.
+ */
+constexpr PeepholePattern peephole_patterns[] = {
+    /* values which are pushed and dropped right away */
+    pattern("push-literal-pop",
+            {op(CBC_PUSH_LITERAL, PeepholeOperand::PURE), op(CBC_POP)}, {}),
+    pattern("push-literal-push-literal-pop",
+            {op(CBC_PUSH_LITERAL), op(CBC_PUSH_LITERAL, PeepholeOperand::PURE),
+             op(CBC_POP)},
+            {emit(CBC_PUSH_LITERAL, {lit(0)})}),
+    pattern("push-two-literals-pop",
+            {op(CBC_PUSH_TWO_LITERALS, PeepholeOperand::PURE), op(CBC_POP)},
+            {emit(CBC_PUSH_LITERAL, {lit(0, 0)})}),
+    pattern("push-three-literals-pop",
+            {op(CBC_PUSH_THREE_LITERALS, PeepholeOperand::PURE), op(CBC_POP)},
+            {emit(CBC_PUSH_TWO_LITERALS, {lit(0, 0), lit(0, 1)})}),
+    pattern("push-this-literal-pop",
+            {op(CBC_PUSH_THIS_LITERAL, PeepholeOperand::PURE), op(CBC_POP)},
+            {emit(CBC_PUSH_THIS)}),
+    pattern("push-literal-number-0-pop",
+            {op(CBC_PUSH_LITERAL_PUSH_NUMBER_0, PeepholeOperand::PURE),
+             op(CBC_POP)},
+            {emit(CBC_PUSH_LITERAL, {lit(0, 0)})}),
+    pattern("push-literal-pos-byte-pop",
+            {op(CBC_PUSH_LITERAL_PUSH_NUMBER_POS_BYTE, PeepholeOperand::PURE),
+             op(CBC_POP)},
+            {emit(CBC_PUSH_LITERAL, {lit(0, 0)})}),
+    pattern("push-literal-neg-byte-pop",
+            {op(CBC_PUSH_LITERAL_PUSH_NUMBER_NEG_BYTE, PeepholeOperand::PURE),
+             op(CBC_POP)},
+            {emit(CBC_PUSH_LITERAL, {lit(0, 0)})}),
+    pattern("push-undefined-pop", {op(CBC_PUSH_UNDEFINED), op(CBC_POP)}, {}),
+    pattern("push-true-pop", {op(CBC_PUSH_TRUE), op(CBC_POP)}, {}),
+    pattern("push-false-pop", {op(CBC_PUSH_FALSE), op(CBC_POP)}, {}),
+    pattern("push-null-pop", {op(CBC_PUSH_NULL), op(CBC_POP)}, {}),
+    pattern("push-number-0-pop", {op(CBC_PUSH_NUMBER_0), op(CBC_POP)}, {}),
+    pattern("push-pos-byte-pop", {op(CBC_PUSH_NUMBER_POS_BYTE), op(CBC_POP)},
+            {}),
+    pattern("push-neg-byte-pop", {op(CBC_PUSH_NUMBER_NEG_BYTE), op(CBC_POP)},
+            {}),
+
+    /* operands consumed by the next instruction */
+    PEEPHOLE_UNARY_PATTERNS(CBC_PLUS),
+    PEEPHOLE_UNARY_PATTERNS(CBC_NEGATE),
+    PEEPHOLE_UNARY_PATTERNS(CBC_LOGICAL_NOT),
+    PEEPHOLE_UNARY_PATTERNS(CBC_BIT_NOT),
+    PEEPHOLE_UNARY_PATTERNS(CBC_VOID),
+    PEEPHOLE_BINARY_PATTERNS(CBC_BIT_OR),
+    PEEPHOLE_BINARY_PATTERNS(CBC_BIT_XOR),
+    PEEPHOLE_BINARY_PATTERNS(CBC_BIT_AND),
+    PEEPHOLE_BINARY_PATTERNS(CBC_EQUAL),
+    PEEPHOLE_BINARY_PATTERNS(CBC_NOT_EQUAL),
+    PEEPHOLE_BINARY_PATTERNS(CBC_STRICT_EQUAL),
+    PEEPHOLE_BINARY_PATTERNS(CBC_STRICT_NOT_EQUAL),
+    PEEPHOLE_BINARY_PATTERNS(CBC_LESS),
+    PEEPHOLE_BINARY_PATTERNS(CBC_GREATER),
+    PEEPHOLE_BINARY_PATTERNS(CBC_LESS_EQUAL),
+    PEEPHOLE_BINARY_PATTERNS(CBC_GREATER_EQUAL),
+    PEEPHOLE_BINARY_PATTERNS(CBC_IN),
+    PEEPHOLE_BINARY_PATTERNS(CBC_INSTANCEOF),
+    PEEPHOLE_BINARY_PATTERNS(CBC_LEFT_SHIFT),
+    PEEPHOLE_BINARY_PATTERNS(CBC_RIGHT_SHIFT),
+    PEEPHOLE_BINARY_PATTERNS(CBC_UNS_RIGHT_SHIFT),
+    PEEPHOLE_BINARY_PATTERNS(CBC_ADD),
+    PEEPHOLE_BINARY_PATTERNS(CBC_SUBTRACT),
+    PEEPHOLE_BINARY_PATTERNS(CBC_MULTIPLY),
+    PEEPHOLE_BINARY_PATTERNS(CBC_DIVIDE),
+    PEEPHOLE_BINARY_PATTERNS(CBC_MODULO),
+#if ENABLED(JERRY_ESNEXT)
+    PEEPHOLE_BINARY_PATTERNS(CBC_EXP),
+#endif /* ENABLED (JERRY_ESNEXT) */
+    pattern("push-prop-two-literals",
+            {op(CBC_PUSH_TWO_LITERALS), op(CBC_PUSH_PROP)},
+            {emit(CBC_PUSH_PROP_LITERAL_LITERAL, {lit(0, 0), lit(0, 1)})}),
+    pattern("push-prop-this-literal",
+            {op(CBC_PUSH_THIS_LITERAL), op(CBC_PUSH_PROP)},
+            {emit(CBC_PUSH_PROP_THIS_LITERAL, {lit(0)})}),
+    pattern("push-prop-right-literal",
+            {op(CBC_PUSH_LITERAL), op(CBC_PUSH_PROP)},
+            {emit(CBC_PUSH_PROP_LITERAL, {lit(0)})}),
+    pattern("return-literal", {op(CBC_PUSH_LITERAL), op(CBC_RETURN)},
+            {emit(CBC_RETURN_WITH_LITERAL, {lit(0)})}),
+
+    /* results stored straight into their destination */
+    PEEPHOLE_SET_IDENT_PATTERNS(CBC_ASSIGN_SET_IDENT,
+                                CBC_ASSIGN_LITERAL_SET_IDENT),
+    PEEPHOLE_SET_IDENT_PATTERNS(CBC_ASSIGN_SET_IDENT_PUSH_RESULT,
+                                CBC_ASSIGN_LITERAL_SET_IDENT_PUSH_RESULT),
+    PEEPHOLE_SET_IDENT_PATTERNS(CBC_ASSIGN_SET_IDENT_BLOCK,
+                                CBC_ASSIGN_LITERAL_SET_IDENT_BLOCK),
+    pattern("mov-ident-literal", {op(CBC_PUSH_LITERAL), op(CBC_MOV_IDENT)},
+            {emit(CBC_ASSIGN_LITERAL_SET_IDENT, {lit(0), lit(1)})}),
+    pattern("assign-set-ident-reload",
+            {op(CBC_ASSIGN_SET_IDENT), op(CBC_PUSH_LITERAL)},
+            {emit(CBC_ASSIGN_SET_IDENT_PUSH_RESULT, {lit(0)})},
+            reloadsRegister),
+    pattern("assign-literal-set-ident-reload",
+            {op(CBC_ASSIGN_LITERAL_SET_IDENT), op(CBC_PUSH_LITERAL)},
+            {emit(CBC_ASSIGN_LITERAL_SET_IDENT_PUSH_RESULT,
+                  {lit(0, 0), lit(0, 1)})},
+            reloadsRegister),
+
+    /* consecutive pushes merged into the multi push forms */
+    pattern("push-two-literals", {op(CBC_PUSH_LITERAL), op(CBC_PUSH_LITERAL)},
+            {emit(CBC_PUSH_TWO_LITERALS, {lit(0), lit(1)})}),
+    pattern("push-three-literals",
+            {op(CBC_PUSH_TWO_LITERALS), op(CBC_PUSH_LITERAL)},
+            {emit(CBC_PUSH_THREE_LITERALS, {lit(0, 0), lit(0, 1), lit(1)})}),
+    pattern("push-literal-two-literals",
+            {op(CBC_PUSH_LITERAL), op(CBC_PUSH_TWO_LITERALS)},
+            {emit(CBC_PUSH_THREE_LITERALS, {lit(0), lit(1, 0), lit(1, 1)})}),
+    pattern("push-this-literal", {op(CBC_PUSH_THIS), op(CBC_PUSH_LITERAL)},
+            {emit(CBC_PUSH_THIS_LITERAL, {lit(1)})}),
+    pattern("push-literal-number-0",
+            {op(CBC_PUSH_LITERAL), op(CBC_PUSH_NUMBER_0)},
+            {emit(CBC_PUSH_LITERAL_PUSH_NUMBER_0, {lit(0)})}),
+    pattern("push-literal-pos-byte",
+            {op(CBC_PUSH_LITERAL), op(CBC_PUSH_NUMBER_POS_BYTE)},
+            {emit(CBC_PUSH_LITERAL_PUSH_NUMBER_POS_BYTE, {lit(0)}, 1)}),
+    pattern("push-literal-neg-byte",
+            {op(CBC_PUSH_LITERAL), op(CBC_PUSH_NUMBER_NEG_BYTE)},
+            {emit(CBC_PUSH_LITERAL_PUSH_NUMBER_NEG_BYTE, {lit(0)}, 1)}),
+};
+
+#undef PEEPHOLE_UNARY_PATTERNS
+#undef PEEPHOLE_BINARY_PATTERNS
+#undef PEEPHOLE_SET_IDENT_PATTERNS
+
+constexpr OpcodeData opcodeData(CBCOpcode opcode) {
+  return OpcodeData(peephole_decode_table[Opcode::decodeIndex(opcode)]);
+}
+
+/**
+ * Number of literal indices encoded after the opcode
+ */
+constexpr uint32_t literalCount(CBCOpcode opcode) {
+  OpcodeData data = opcodeData(opcode);
+  GroupOpcode group = data.groupOpcode();
+  uint32_t count = 0;
+
+  switch (data.operands()) {
+  case OperandType::LITERAL:
+  case OperandType::STACK_LITERAL:
+  case OperandType::THIS_LITERAL: {
+    count = 1;
+    break;
+  }
+  case OperandType::LITERAL_LITERAL: {
+    count = 2;
+    break;
+  }
+  default: {
+    break;
+  }
+  }
+
+  if (group == VM_OC_PUSH_THREE || group == VM_OC_MOV_IDENT) {
+    count++;
+  }
+
+  /* increment and decrement write back to their operand */
+  if (data.isPutIdent() &&
+      (group < VM_OC_PRE_INCR || group > VM_OC_POST_DECR)) {
+    count++;
+  }
+
+  return count;
+}
+
+constexpr bool isBranch(CBCOpcode opcode) {
+  return opcodeData(opcode).operands() == OperandType::BRANCH;
+}
+
+constexpr bool isValidSource(const PeepholePattern &pattern, uint8_t source) {
+  return source == PEEPHOLE_NO_SOURCE || source < pattern.length;
+}
+
+constexpr bool isValidPattern(const PeepholePattern &pattern) {
+  if (pattern.length == 0 || pattern.replacement_count > pattern.length) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < pattern.length; i++) {
+    CBCOpcode opcode = pattern.match[i].opcode;
+
+    if (Opcode::decodeIndex(opcode) >= peephole_opcode_count ||
+        (isBranch(opcode) && CBC_BRANCH_OFFSET_LENGTH(opcode) != 1)) {
+      return false;
+    }
+  }
+
+  for (uint8_t i = 0; i < pattern.replacement_count; i++) {
+    const PeepholeReplacement &replacement = pattern.replacement[i];
+
+    if (Opcode::decodeIndex(replacement.opcode) >= peephole_opcode_count ||
+        replacement.literal_count != literalCount(replacement.opcode) ||
+        !isValidSource(pattern, replacement.byte_arg) ||
+        !isValidSource(pattern, replacement.branch)) {
+      return false;
+    }
+
+    if (isBranch(replacement.opcode) !=
+        (replacement.branch != PEEPHOLE_NO_SOURCE)) {
+      return false;
+    }
+
+    if (isBranch(replacement.opcode) &&
+        (CBC_BRANCH_OFFSET_LENGTH(replacement.opcode) != 1 ||
+         !isBranch(pattern.match[replacement.branch].opcode))) {
+      return false;
+    }
+
+    for (uint8_t j = 0; j < replacement.literal_count; j++) {
+      const PeepholeLiteral &literal = replacement.literals[j];
+
+      if (literal.ins >= pattern.length ||
+          literal.index >= literalCount(pattern.match[literal.ins].opcode)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+constexpr bool isValidPatternTable() {
+  for (auto &pattern : peephole_patterns) {
+    if (!isValidPattern(pattern)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static_assert(isValidPatternTable(), "invalid peephole pattern");
+
+/**
+ * Branches are matched regardless of their offset length
+ */
+CBCOpcode matchedOpcode(Ins *ins) {
+  Opcode &opcode = ins->opcode();
+
+  if (ins->argument().type() != OperandType::BRANCH) {
+    return opcode.CBCopcode();
+  }
+
+  return static_cast<CBCOpcode>(opcode.CBCopcode() -
+                                opcode.branchOffsetLength() + 1);
+}
+
+} // namespace
+
+Peephole::Peephole() : Pass() {
+  dispatch_.resize(peephole_opcode_count);
+
+  for (auto &pattern : peephole_patterns) {
+    dispatch_[Opcode::decodeIndex(pattern.match[0].opcode)].push_back(&pattern);
+  }
+}
+
+Peephole::~Peephole() {}
+
+bool Peephole::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::CONTROL_FLOW_ANALYSIS));
+
+  /* every block is rewritten until none of its windows match */
+  for (auto bb : byte_code->basicBlockList()) {
+    optimizeBasicBlock(byte_code, bb);
+  }
+
+  return true;
+}
+
+bool Peephole::optimizeBasicBlock(Bytecode *byte_code, BasicBlock *bb) {
+  InsList &insns = bb->insns();
+  bool changed = false;
+  size_t i = 0;
+
+  while (i < insns.size()) {
+    const PeepholePattern *pattern = match(byte_code, insns, i);
+
+    if (pattern == nullptr) {
+      i++;
+      continue;
+    }
+
+    LOG("Peephole " << pattern->name << " at " << *insns[i]);
+    rewrite(byte_code, insns, i, pattern);
+    changed = true;
+
+    /* the result may complete a window which starts before it */
+    i = i < PEEPHOLE_MAX_WINDOW - 1 ? 0 : i - (PEEPHOLE_MAX_WINDOW - 1);
+  }
+
+  return changed;
+}
+
+const PeepholePattern *Peephole::match(Bytecode *byte_code, InsList &insns,
+                                       size_t start) {
+  uint32_t index = Opcode::decodeIndex(matchedOpcode(insns[start]));
+
+  for (auto pattern : dispatch_[index]) {
+    if (start + pattern->length > insns.size()) {
+      continue;
+    }
+
+    Ins **window = &insns[start];
+    bool matched = true;
+
+    for (uint8_t i = 0; matched && i < pattern->length; i++) {
+      matched = !window[i]->hasFlag(InstFlags::DEAD) &&
+                matchedOpcode(window[i]) == pattern->match[i].opcode &&
+                matchOperand(byte_code, window[i], pattern->match[i].operand);
+    }
+
+    if (matched &&
+        (pattern->guard == nullptr || pattern->guard(byte_code, window))) {
+      return pattern;
+    }
+  }
+
+  return nullptr;
+}
+
+void Peephole::rewrite(Bytecode *byte_code, InsList &insns, size_t start,
+                       const PeepholePattern *pattern) {
+  Ins *window[PEEPHOLE_MAX_WINDOW];
+  InsList replacements;
+
+  std::copy(insns.begin() + start, insns.begin() + start + pattern->length,
+            window);
+
+  /* build every replacement before the matched instructions are freed */
+  for (uint8_t i = 0; i < pattern->replacement_count; i++) {
+    const PeepholeReplacement &replacement = pattern->replacement[i];
+    std::vector<Literal> literals;
+
+    for (uint8_t j = 0; j < replacement.literal_count; j++) {
+      const PeepholeLiteral &source = replacement.literals[j];
+      literals.push_back(
+          window[source.ins]->argument().literals()[source.index]);
+    }
+
+    Ins *ins = Ins::create(byte_code, Opcode(replacement.opcode), literals);
+
+    if (replacement.byte_arg != PEEPHOLE_NO_SOURCE) {
+      ins->argument().setByteArg(
+          window[replacement.byte_arg]->argument().byteArg());
+    }
+
+    /* the replacement takes the offset of the i-th matched instruction */
+    if (replacement.branch != PEEPHOLE_NO_SOURCE) {
+      int32_t target = window[replacement.branch]->jumpTarget();
+      ins->argument().setBranchOffset(
+          target - static_cast<int32_t>(window[i]->offset()));
+    }
+
+    replacements.push_back(ins);
+  }
+
+  for (uint8_t i = 0; i < pattern->length; i++) {
+    if (i < replacements.size()) {
+      byte_code->replaceIns(window[i], replacements[i]);
+    } else {
+      byte_code->removeIns(window[i]);
+    }
+  }
+}
+
+bool Peephole::matchOperand(Bytecode *byte_code, Ins *ins,
+                            PeepholeOperand operand) {
+  if (operand == PeepholeOperand::ANY) {
+    return true;
+  }
+
+  BytecodeArguments &args = byte_code->args();
+
+  for (auto &literal : ins->argument().literals()) {
+    bool is_register = literal.index() < args.registerEnd();
+    bool is_constant = literal.index() >= args.identEnd() &&
+                       literal.index() < args.constLiteralEnd();
+
+    switch (operand) {
+    case PeepholeOperand::PURE: {
+      if (!is_register && !is_constant) {
+        return false;
+      }
+      break;
+    }
+    case PeepholeOperand::REGISTER: {
+      if (!is_register) {
+        return false;
+      }
+      break;
+    }
+    case PeepholeOperand::CONSTANT: {
+      if (!is_constant) {
+        return false;
+      }
+      break;
+    }
+    default: {
+      unreachable();
+    }
+    }
+  }
+
+  return true;
+}
+
+} // namespace optimizer
@@ -0,0 +1,98 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+#define PEEPHOLE_MAX_WINDOW 3
+#define PEEPHOLE_MAX_LITERALS 3
+#define PEEPHOLE_NO_SOURCE UINT8_MAX
+
+/**
+ * Constraint on every literal operand of a matched instruction
+ */
+enum class PeepholeOperand : uint8_t {
+  ANY,
+  PURE, /* register, argument or constant: reading it has no side effect */
+  REGISTER,
+  CONSTANT,
+};
+
+struct PeepholeMatch {
+  CBCOpcode opcode;
+  PeepholeOperand operand;
+};
+
+/**
+ * The 'index'th literal of the 'ins'th matched instruction
+ */
+struct PeepholeLiteral {
+  uint8_t ins;
+  uint8_t index;
+};
+
+struct PeepholeReplacement {
+  CBCOpcode opcode;
+  uint8_t literal_count;
+  PeepholeLiteral literals[PEEPHOLE_MAX_LITERALS];
+  /* matched instruction whose byte argument is copied */
+  uint8_t byte_arg;
+  /* matched instruction whose jump target is kept */
+  uint8_t branch;
+};
+
+/**
+ * Extra condition which cannot be expressed by the match list
+ */
+using PeepholeGuard = bool (*)(Bytecode *byte_code, Ins **window);
+
+struct PeepholePattern {
+  const char *name;
+  uint8_t length;
+  PeepholeMatch match[PEEPHOLE_MAX_WINDOW];
+  uint8_t replacement_count;
+  PeepholeReplacement replacement[PEEPHOLE_MAX_WINDOW];
+  PeepholeGuard guard;
+};
+
+class Peephole : public Pass {
+public:
+  Peephole();
+  ~Peephole();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "Peephole"; }
+
+  virtual PassKind kind() { return PassKind::PEEPHOLE; }
+
+private:
+  bool optimizeBasicBlock(Bytecode *byte_code, BasicBlock *bb);
+  const PeepholePattern *match(Bytecode *byte_code, InsList &insns,
+                               size_t start);
+  void rewrite(Bytecode *byte_code, InsList &insns, size_t start,
+               const PeepholePattern *pattern);
+
+  static bool matchOperand(Bytecode *byte_code, Ins *ins,
+                           PeepholeOperand operand);
+
+  std::vector<std::vector<const PeepholePattern *>> dispatch_;
+};
+
+} // namespace optimizer
+
+#endif // PEEPHOLE_H
@@ -0,0 +1,342 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "regalloc-graph-coloring.h"
+#include "basic-block.h"
+#include "liveness-analysis.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+RegallocGraphColoring::RegallocGraphColoring()
+    : Pass(), regs_count_(0), args_count_(0) {}
+
+RegallocGraphColoring::~RegallocGraphColoring() {}
+
+bool RegallocGraphColoring::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::LIVENESS_ANALYSIS));
+
+  regs_count_ = byte_code->args().registerEnd();
+  args_count_ = byte_code->args().argumentEnd();
+  graph_.assign(regs_count_, RegSet());
+  alias_.clear();
+  colors_.clear();
+  moves_.clear();
+
+  if (regs_count_ == 0 || !isSupported(byte_code)) {
+    return true;
+  }
+
+  for (uint32_t i = 0; i < regs_count_; i++) {
+    alias_.push_back(i);
+  }
+
+  buildGraph(byte_code);
+
+  /* the first coloring is kept if no move is coalesced */
+  uint32_t colors = color();
+
+  if (coalesce(colors)) {
+    colors = color();
+  }
+
+  LOG("NEW TOTAL REGS: " << colors);
+
+  updateInstructions(byte_code, colors);
+  LivenessAnalysis::orderRegisters(optimizer, byte_code);
+  return true;
+}
+
+/**
+ * Every instruction has to be covered by the liveness of its block. The
+ * handlers of a try context are not successors of the throwing blocks.
+ */
+bool RegallocGraphColoring::isSupported(Bytecode *byte_code) {
+  size_t count = 0;
+
+  for (auto bb : byte_code->basicBlockList()) {
+    if (bb->isValid()) {
+      count += bb->insns().size();
+    }
+  }
+
+  if (count != byte_code->instructions().size()) {
+    return false;
+  }
+
+  for (auto ins : byte_code->instructions()) {
+    if (ins->isTryContext()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void RegallocGraphColoring::buildGraph(Bytecode *byte_code) {
+  BasicBlockList &bbs = byte_code->basicBlockList();
+
+  for (auto bb : bbs) {
+    if (!bb->isValid()) {
+      continue;
+    }
+
+    RegSet live = bb->liveOut();
+
+    for (auto iter = bb->insns().rbegin(); iter != bb->insns().rend();
+         iter++) {
+      Ins *ins = *iter;
+
+      if (ins->hasFlag(InstFlags::WRITE_REG)) {
+        uint32_t write_reg = ins->writeReg();
+        bool is_move = isMove(byte_code, ins);
+
+        if (is_move) {
+          moves_.push_back(ins);
+        }
+
+        for (auto reg : live) {
+          /* the source of a move may share the register of its result */
+          if (is_move &&
+              reg == ins->argument().literals().front().index()) {
+            continue;
+          }
+
+          addEdge(write_reg, reg);
+        }
+
+        live.erase(write_reg);
+      }
+
+      for (auto reg : LivenessAnalysis::uses(ins)) {
+        live.insert(reg);
+      }
+    }
+  }
+
+  RegSet &entry_live = bbs.front()->liveOut();
+
+  /* the arguments are written on entry */
+  for (uint32_t i = 0; i < args_count_; i++) {
+    for (uint32_t j = 0; j < args_count_; j++) {
+      addEdge(i, j);
+    }
+
+    for (auto reg : entry_live) {
+      addEdge(i, reg);
+    }
+  }
+
+  /* registers read before written rely on their initial undefined value */
+  for (auto reg : entry_live) {
+    if (reg < args_count_) {
+      continue;
+    }
+
+    for (uint32_t i = 0; i < regs_count_; i++) {
+      addEdge(reg, i);
+    }
+  }
+}
+
+void RegallocGraphColoring::addEdge(uint32_t a, uint32_t b) {
+  if (a == b) {
+    return;
+  }
+
+  graph_[a].insert(b);
+  graph_[b].insert(a);
+}
+
+/**
+ * Briggs' conservative coalescing: the merged register has fewer than
+ * 'colors' neighbors of significant degree, so the coloring is kept
+ */
+bool RegallocGraphColoring::coalesce(uint32_t colors) {
+  bool merged = false;
+
+  for (auto ins : moves_) {
+    uint32_t dst = find(ins->writeReg());
+    uint32_t src = find(ins->argument().literals().front().index());
+
+    if (dst == src || graph_[dst].count(src) != 0 ||
+        (dst < args_count_ && src < args_count_) ||
+        !canCoalesce(dst, src, colors)) {
+      continue;
+    }
+
+    /* arguments keep their register */
+    if (src < args_count_) {
+      std::swap(dst, src);
+    }
+
+    LOG("Coalesce REG: " << src << " into REG: " << dst);
+    merge(dst, src);
+    merged = true;
+  }
+
+  return merged;
+}
+
+bool RegallocGraphColoring::canCoalesce(uint32_t a, uint32_t b,
+                                        uint32_t colors) {
+  RegSet neighbors = graph_[a];
+  neighbors.insert(graph_[b].begin(), graph_[b].end());
+
+  uint32_t significant = 0;
+
+  for (auto reg : neighbors) {
+    if (graph_[reg].size() >= colors) {
+      significant++;
+    }
+  }
+
+  return significant < colors;
+}
+
+void RegallocGraphColoring::merge(uint32_t a, uint32_t b) {
+  for (auto reg : graph_[b]) {
+    graph_[reg].erase(b);
+    addEdge(a, reg);
+  }
+
+  graph_[b].clear();
+  alias_[b] = a;
+}
+
+uint32_t RegallocGraphColoring::find(uint32_t reg) {
+  while (alias_[reg] != reg) {
+    reg = alias_[reg];
+  }
+
+  return reg;
+}
+
+/**
+ * Simplify by removing the register of the smallest degree, then select the
+ * lowest color unused by the neighbors. Arguments are precolored.
+ */
+uint32_t RegallocGraphColoring::color() {
+  std::vector<size_t> degrees(regs_count_);
+  std::vector<bool> removed(regs_count_, false);
+  RegList stack;
+
+  for (uint32_t i = 0; i < regs_count_; i++) {
+    degrees[i] = graph_[i].size();
+
+    if (i < args_count_ || find(i) != i) {
+      removed[i] = true;
+    }
+  }
+
+  while (true) {
+    uint32_t next = regs_count_;
+
+    for (uint32_t i = 0; i < regs_count_; i++) {
+      if (!removed[i] && (next == regs_count_ || degrees[i] < degrees[next])) {
+        next = i;
+      }
+    }
+
+    if (next == regs_count_) {
+      break;
+    }
+
+    removed[next] = true;
+    stack.push_back(next);
+
+    for (auto reg : graph_[next]) {
+      degrees[reg]--;
+    }
+  }
+
+  colors_.assign(regs_count_, regs_count_);
+  uint32_t colors = args_count_;
+
+  for (uint32_t i = 0; i < args_count_; i++) {
+    colors_[i] = i;
+  }
+
+  while (!stack.empty()) {
+    uint32_t reg = stack.back();
+    stack.pop_back();
+
+    std::vector<bool> used(regs_count_, false);
+
+    for (auto neighbor : graph_[reg]) {
+      if (colors_[neighbor] < regs_count_) {
+        used[colors_[neighbor]] = true;
+      }
+    }
+
+    uint32_t color = 0;
+
+    while (used[color]) {
+      color++;
+    }
+
+    colors_[reg] = color;
+    colors = std::max(colors, color + 1);
+  }
+
+  return colors;
+}
+
+void RegallocGraphColoring::updateInstructions(Bytecode *byte_code,
+                                               uint32_t colors) {
+  assert(colors <= regs_count_);
+  int32_t offset = static_cast<int32_t>(colors) -
+                   static_cast<int32_t>(regs_count_);
+
+  for (auto ins : byte_code->instructions()) {
+    for (auto &lit : ins->argument().literals()) {
+      if (lit.index() < regs_count_) {
+        lit.setIndex(colors_[find(lit.index())]);
+      } else {
+        lit.moveIndex(offset);
+      }
+    }
+
+    for (auto &reg : ins->readRegs()) {
+      reg = colors_[find(reg)];
+    }
+
+    if (ins->hasFlag(InstFlags::WRITE_REG)) {
+      ins->writeReg() = colors_[find(ins->writeReg())];
+    }
+  }
+
+  byte_code->args().moveRegIndex(offset);
+  byte_code->literalPool().movePoolStart(offset);
+
+  /* coalesced moves copy a register onto itself */
+  for (auto ins : moves_) {
+    auto &literals = ins->argument().literals();
+
+    if (literals.front().index() == literals.back().index()) {
+      LOG("Remove coalesced move: " << *ins);
+      byte_code->removeIns(ins);
+    }
+  }
+}
+
+/**
+ * Register to register copy which leaves no result behind
+ */
+bool RegallocGraphColoring::isMove(Bytecode *byte_code, Ins *ins) {
+  OpcodeData data = ins->opcode().opcodeData();
+  auto &literals = ins->argument().literals();
+
+  return data.groupOpcode() == VM_OC_ASSIGN && data.isPutIdent() &&
+         !data.isPutStack() && !data.isPutBlock() &&
+         data.operands() == OperandType::LITERAL && literals.size() == 2 &&
+         literals.front().index() < byte_code->args().registerEnd() &&
+         literals.back().index() < byte_code->args().registerEnd();
+}
+
+} // namespace optimizer
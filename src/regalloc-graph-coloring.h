@@ -0,0 +1,57 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef REGALLOC_GRAPH_COLORING_H
+#define REGALLOC_GRAPH_COLORING_H
+
+#include "bytecode.h"
+#include "common.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class RegallocGraphColoring : public Pass {
+public:
+  RegallocGraphColoring();
+  ~RegallocGraphColoring();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "RegAllocGraphColoring"; }
+
+  virtual PassKind kind() { return PassKind::REGALLOC_GRAPH_COLORING; }
+
+private:
+  bool isSupported(Bytecode *byte_code);
+  void buildGraph(Bytecode *byte_code);
+  void addEdge(uint32_t a, uint32_t b);
+  bool coalesce(uint32_t colors);
+  bool canCoalesce(uint32_t a, uint32_t b, uint32_t colors);
+  void merge(uint32_t a, uint32_t b);
+  uint32_t color();
+  void updateInstructions(Bytecode *byte_code, uint32_t colors);
+
+  uint32_t find(uint32_t reg);
+
+  static bool isMove(Bytecode *byte_code, Ins *ins);
+
+  uint32_t regs_count_;
+  uint32_t args_count_;
+  /* interference graph of the coalesced registers */
+  std::vector<RegSet> graph_;
+  /* representative of each register after coalescing */
+  RegList alias_;
+  RegList colors_;
+  InsList moves_;
+};
+
+} // namespace optimizer
+
+#endif // REGALLOC_GRAPH_COLORING_H
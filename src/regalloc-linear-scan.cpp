@@ -33,16 +33,31 @@ bool RegallocLinearScan::run(Optimizer *optimizer, Bytecode *byte_code) {
   sortIntervals(byte_code);
   computeRegisterMapping(byte_code);
   updateInstructions(byte_code);
+  LivenessAnalysis::orderRegisters(optimizer, byte_code);
 
   return true;
 }
 
 void RegallocLinearScan::sortIntervals(Bytecode *byte_code) {
+  RegSet entry_live =
+      LivenessAnalysis::liveIn(byte_code->basicBlockList().front());
 
   for (auto &iter : byte_code->liveRanges()) {
+    /* every occurrence of a register is renamed to the same register, so
+       its intervals are merged */
+    LiveInterval *merged = iter.second.front();
+
     for (auto res : iter.second) {
-      intervals_.push_back({{iter.first, iter.first}, res});
+      merged->setStart(std::min(merged->start(), res->start()));
+      merged->setEnd(std::max({merged->end(), res->start(), res->end()}));
+    }
+
+    /* registers read before written rely on their initial value */
+    if (entry_live.find(iter.first) != entry_live.end()) {
+      merged->setStart(0);
     }
+
+    intervals_.push_back({{iter.first, iter.first}, merged});
   }
 
   std::sort(intervals_.begin(), intervals_.end(),
@@ -64,31 +79,36 @@ void RegallocLinearScan::sortIntervals(Bytecode *byte_code) {
 }
 
 void RegallocLinearScan::computeRegisterMapping(Bytecode *byte_code) {
+  uint32_t args_count = byte_code->args().argumentEnd();
   RegLiveIntervalList active;
   RegList registers;
 
-  for (int32_t i = regs_count_ - 1; i >= 0; i--) {
-    registers.push_back(i);
+  for (uint32_t i = regs_count_; i > args_count; i--) {
+    registers.push_back(i - 1);
   }
 
+  /* arguments are passed in their registers */
   for (auto &iter : intervals_) {
-    expireOldIntervals(active, registers, iter);
-
-    if (active.size() == regs_count_) {
-      return;
+    if (iter.first.first < args_count) {
+      active.push_back(iter);
     }
+  }
+
+  new_regs_count_ = args_count;
 
-    if (iter.second->start() == iter.second->end()) {
+  for (auto &iter : intervals_) {
+    if (iter.first.first < args_count) {
       continue;
     }
 
+    expireOldIntervals(active, registers, iter);
+    assert(!registers.empty());
+
     iter.first.second = registers.back();
     registers.pop_back();
     active.push_back(iter);
 
-    if (active.size() > new_regs_count_) {
-      new_regs_count_ = active.size();
-    }
+    new_regs_count_ = std::max(new_regs_count_, iter.first.second + 1);
   }
 
   LOG("----------------------------------------------------");
@@ -116,8 +136,10 @@ void RegallocLinearScan::expireOldIntervals(RegLiveIntervalList &active,
               return false;
             });
 
+  /* an interval ending at the start of the next one is still used by that
+     instruction */
   for (auto iter = active.begin(); iter != active.end();) {
-    if ((*iter).second->end() > interval.second->start()) {
+    if ((*iter).second->end() >= interval.second->start()) {
       return;
     }
 
@@ -126,52 +148,49 @@ void RegallocLinearScan::expireOldIntervals(RegLiveIntervalList &active,
   }
 }
 
+/**
+ * Every literal of the register range is renamed regardless of the flags of
+ * its instruction, as the destinations of the created instructions are not
+ * listed in their read registers
+ */
 void RegallocLinearScan::updateInstructions(Bytecode *byte_code) {
   if (new_regs_count_ >= regs_count_) {
     return;
   }
 
-  int32_t offset = new_regs_count_ - regs_count_;
-
-  for (auto &iter : intervals_) {
-    for (auto ins : byte_code->instructions()) {
-      Argument &arg = ins->argument();
-      if (ins->hasFlag(InstFlags::READ_REG)) {
-        for (auto &reg : ins->readRegs()) {
-          if (iter.first.first == reg) {
-            reg = iter.first.second;
-          }
-        }
-
-        for (auto &lit : arg.literals()) {
-          if (lit.index() == iter.first.first) {
-            lit.setIndex(iter.first.second);
-          }
-        }
-      }
+  int32_t offset = static_cast<int32_t>(new_regs_count_) -
+                   static_cast<int32_t>(regs_count_);
+  RegList new_index(regs_count_);
 
-      if (ins->hasFlag(InstFlags::WRITE_REG)) {
-        uint32_t &write_reg = ins->writeReg();
+  for (uint32_t i = 0; i < regs_count_; i++) {
+    new_index[i] = i;
+  }
 
-        if (iter.first.first == write_reg) {
-          write_reg = iter.first.second;
-        }
-      }
-    }
+  for (auto &iter : intervals_) {
+    new_index[iter.first.first] = iter.first.second;
   }
 
   for (auto ins : byte_code->instructions()) {
-    Argument &arg = ins->argument();
-    for (auto &lit : arg.literals()) {
-      if (lit.index() >= byte_code->args().registerEnd()) {
+    for (auto &lit : ins->argument().literals()) {
+      if (lit.index() < regs_count_) {
+        assert(new_index[lit.index()] < new_regs_count_);
+        lit.setIndex(static_cast<LiteralIndex>(new_index[lit.index()]));
+      } else {
         lit.moveIndex(offset);
       }
     }
+
+    for (auto &reg : ins->readRegs()) {
+      reg = new_index[reg];
+    }
+
+    if (ins->hasFlag(InstFlags::WRITE_REG)) {
+      ins->writeReg() = new_index[ins->writeReg()];
+    }
   }
 
   byte_code->args().moveRegIndex(offset);
-  byte_code->literalPool().movePoolStart(offset -
-                                         byte_code->args().argumentEnd());
+  byte_code->literalPool().movePoolStart(offset);
 
   for (auto bb : byte_code->basicBlockList()) {
     LOG(*bb);
@@ -0,0 +1,272 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "register-analysis.h"
+#include "basic-block.h"
+
+namespace optimizer {
+
+void RegisterAnalysis::analyze(Bytecode *byte_code) {
+  BytecodeArguments &args = byte_code->args();
+
+  untracked_.clear();
+  write_count_.assign(args.registerEnd(), 0);
+
+  for (auto ins : byte_code->instructions()) {
+    if (ins->hasFlag(InstFlags::DEAD)) {
+      continue;
+    }
+
+    if (ins->hasFlag(InstFlags::WRITE_REG)) {
+      write_count_[ins->writeReg()]++;
+    }
+
+    if (ins->opcode().opcodeData().groupOpcode() != VM_OC_IDENT_REFERENCE) {
+      continue;
+    }
+
+    for (auto &literal : ins->argument().literals()) {
+      if (literal.index() < args.registerEnd()) {
+        untracked_.insert(literal.index());
+      }
+    }
+  }
+
+  /* mapped arguments are aliased by the arguments object */
+  if (byte_code->flags().mappedArgumentsNeeded()) {
+    for (LiteralIndex i = 0; i < args.argumentEnd(); i++) {
+      untracked_.insert(i);
+    }
+  }
+
+  computeKinds(byte_code);
+}
+
+bool RegisterAnalysis::isUntracked(uint32_t reg) const {
+  return untracked_.find(reg) != untracked_.end();
+}
+
+/**
+ * The register is written at most once, and never through a reference
+ */
+bool RegisterAnalysis::isStable(uint32_t reg) const {
+  return reg < write_count_.size() && write_count_[reg] <= 1 &&
+         !isUntracked(reg);
+}
+
+/**
+ * Bigint constants are also kept in the literal pool, they are primitive
+ * but not plain values
+ */
+ValueKind RegisterAnalysis::kind(Bytecode *byte_code, Literal &literal) const {
+  BytecodeArguments &args = byte_code->args();
+  LiteralIndex index = literal.index();
+
+  if (index < args.registerEnd()) {
+    return index < kinds_.size() ? kinds_[index] : ValueKind::ANY;
+  }
+
+  if (index < args.identEnd() || index >= args.constLiteralEnd()) {
+    return ValueKind::ANY;
+  }
+
+  ecma_value_t value = byte_code->literalPool().at(index);
+
+  if (ecma_is_value_number(value) || ecma_is_value_string(value)) {
+    return ValueKind::PLAIN;
+  }
+
+  return ValueKind::PRIMITIVE;
+}
+
+/**
+ * A never written register keeps undefined, a single write may store a value
+ * of a known kind
+ */
+void RegisterAnalysis::computeKinds(Bytecode *byte_code) {
+  BytecodeArguments &args = byte_code->args();
+  kinds_.assign(args.registerEnd(), ValueKind::ANY);
+
+  for (uint32_t reg = args.argumentEnd(); reg < args.registerEnd(); reg++) {
+    if (write_count_[reg] == 0 && isStable(reg)) {
+      kinds_[reg] = ValueKind::PLAIN;
+    }
+  }
+
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+
+    for (auto ins : byte_code->instructions()) {
+      if (ins->hasFlag(InstFlags::DEAD) ||
+          !ins->hasFlag(InstFlags::WRITE_REG)) {
+        continue;
+      }
+
+      uint32_t reg = ins->writeReg();
+
+      if (kinds_[reg] == ValueKind::PLAIN || !isStable(reg)) {
+        continue;
+      }
+
+      ValueKind produced = produces(byte_code, ins);
+
+      if (produced > kinds_[reg]) {
+        kinds_[reg] = produced;
+        changed = true;
+      }
+    }
+  }
+}
+
+ValueKind RegisterAnalysis::produces(Bytecode *byte_code, Ins *ins) const {
+  OpcodeData data = ins->opcode().opcodeData();
+
+  switch (data.groupOpcode()) {
+  case VM_OC_PRE_INCR:
+  case VM_OC_PRE_DECR:
+  case VM_OC_POST_INCR:
+  case VM_OC_POST_DECR: {
+    return ValueKind::PRIMITIVE;
+  }
+  case VM_OC_ASSIGN: {
+    if (data.operands() == OperandType::LITERAL) {
+      return kind(byte_code, ins->argument().literals()[0]);
+    }
+
+    return pushed(byte_code, ins);
+  }
+  case VM_OC_MOV_IDENT: {
+    return pushed(byte_code, ins);
+  }
+  default: {
+    return ValueKind::ANY;
+  }
+  }
+}
+
+/**
+ * Kind of the value pushed right before 'ins' in its block
+ */
+ValueKind RegisterAnalysis::pushed(Bytecode *byte_code, Ins *ins) const {
+  Ins *prev = byte_code->previous(ins);
+
+  if (prev == nullptr || prev->bb() != ins->bb()) {
+    return ValueKind::ANY;
+  }
+
+  return pushes(byte_code, prev);
+}
+
+/**
+ * Kind of the value left on the top of the stack
+ */
+ValueKind RegisterAnalysis::pushes(Bytecode *byte_code, Ins *ins) const {
+  OpcodeData data = ins->opcode().opcodeData();
+
+  switch (data.groupOpcode()) {
+  case VM_OC_PUSH:
+  case VM_OC_PUSH_TWO:
+  case VM_OC_PUSH_THREE: {
+    return kind(byte_code, ins->argument().literals().back());
+  }
+  case VM_OC_PUSH_UNDEFINED:
+  case VM_OC_PUSH_TRUE:
+  case VM_OC_PUSH_FALSE:
+  case VM_OC_PUSH_NULL:
+  case VM_OC_PUSH_0:
+  case VM_OC_PUSH_POS_BYTE:
+  case VM_OC_PUSH_NEG_BYTE:
+  case VM_OC_PUSH_LIT_0:
+  case VM_OC_PUSH_LIT_POS_BYTE:
+  case VM_OC_PUSH_LIT_NEG_BYTE: {
+    return ValueKind::PLAIN;
+  }
+  default: {
+    if (!data.isPutStack()) {
+      return ValueKind::ANY;
+    }
+
+    /* their result is a boolean, a string or undefined */
+    if (isAlwaysPure(data.groupOpcode())) {
+      return ValueKind::PLAIN;
+    }
+
+    return isPrimitiveResult(data.groupOpcode()) ? ValueKind::PRIMITIVE
+                                                 : ValueKind::ANY;
+  }
+  }
+}
+
+/**
+ * Operations whose result is always a primitive value
+ */
+bool RegisterAnalysis::isPrimitiveResult(GroupOpcode group) {
+  switch (group) {
+  case VM_OC_EQUAL:
+  case VM_OC_NOT_EQUAL:
+  case VM_OC_STRICT_EQUAL:
+  case VM_OC_STRICT_NOT_EQUAL:
+  case VM_OC_LESS:
+  case VM_OC_GREATER:
+  case VM_OC_LESS_EQUAL:
+  case VM_OC_GREATER_EQUAL:
+  case VM_OC_IN:
+  case VM_OC_INSTANCEOF:
+  case VM_OC_NOT:
+  case VM_OC_TYPEOF:
+  case VM_OC_TYPEOF_IDENT:
+  case VM_OC_VOID:
+  case VM_OC_PLUS:
+  case VM_OC_MINUS:
+  case VM_OC_BIT_NOT:
+  case VM_OC_BIT_OR:
+  case VM_OC_BIT_XOR:
+  case VM_OC_BIT_AND:
+  case VM_OC_LEFT_SHIFT:
+  case VM_OC_RIGHT_SHIFT:
+  case VM_OC_UNS_RIGHT_SHIFT:
+  case VM_OC_ADD:
+  case VM_OC_SUB:
+  case VM_OC_MUL:
+  case VM_OC_DIV:
+  case VM_OC_MOD:
+#if ENABLED(JERRY_ESNEXT)
+  case VM_OC_EXP:
+#endif /* ENABLED (JERRY_ESNEXT) */
+  {
+    return true;
+  }
+  default: {
+    return false;
+  }
+  }
+}
+
+/**
+ * Operations which neither throw nor call user code, whatever their operands
+ * are
+ */
+bool RegisterAnalysis::isAlwaysPure(GroupOpcode group) {
+  switch (group) {
+  case VM_OC_STRICT_EQUAL:
+  case VM_OC_STRICT_NOT_EQUAL:
+  case VM_OC_NOT:
+  case VM_OC_TYPEOF:
+  case VM_OC_TYPEOF_IDENT:
+  case VM_OC_VOID: {
+    return true;
+  }
+  default: {
+    return false;
+  }
+  }
+}
+
+} // namespace optimizer
@@ -0,0 +1,60 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef REGISTER_ANALYSIS_H
+#define REGISTER_ANALYSIS_H
+
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+
+namespace optimizer {
+
+/**
+ * Values a register can hold, each kind is a subset of the previous one
+ */
+enum class ValueKind {
+  ANY,
+  /* converting the value never calls user code */
+  PRIMITIVE,
+  /* number, string, boolean or nullish */
+  PLAIN,
+};
+
+/**
+ * Writes and value kinds of the registers of a function
+ */
+class RegisterAnalysis {
+public:
+  RegisterAnalysis() {}
+
+  void analyze(Bytecode *byte_code);
+
+  uint32_t writeCount(uint32_t reg) const { return write_count_[reg]; }
+  bool isUntracked(uint32_t reg) const;
+  bool isStable(uint32_t reg) const;
+  ValueKind kind(Bytecode *byte_code, Literal &literal) const;
+
+  static bool isPrimitiveResult(GroupOpcode group);
+  static bool isAlwaysPure(GroupOpcode group);
+
+private:
+  void computeKinds(Bytecode *byte_code);
+  ValueKind produces(Bytecode *byte_code, Ins *ins) const;
+  ValueKind pushed(Bytecode *byte_code, Ins *ins) const;
+  ValueKind pushes(Bytecode *byte_code, Ins *ins) const;
+
+  std::vector<uint32_t> write_count_;
+  std::vector<ValueKind> kinds_;
+  /* registers which may be written through a reference */
+  RegSet untracked_;
+};
+
+} // namespace optimizer
+
+#endif // REGISTER_ANALYSIS_H
@@ -0,0 +1,187 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "scope-analysis.h"
+
+namespace optimizer {
+
+/**
+ * The instruction may refer to any binding by a name computed at run time
+ */
+bool ScopeAnalysis::isDynamicScope(Ins *ins) {
+  switch (ins->opcode().opcodeData().groupOpcode()) {
+  case VM_OC_EVAL:
+  case VM_OC_WITH:
+  case VM_OC_LOCAL_EVAL:
+#if ENABLED(JERRY_ESNEXT)
+  case VM_OC_VAR_EVAL:
+  case VM_OC_EXT_VAR_EVAL:
+#endif /* ENABLED (JERRY_ESNEXT) */
+  {
+    return true;
+  }
+  default: {
+    return false;
+  }
+  }
+}
+
+bool ScopeAnalysis::hasDynamicScope(Bytecode *byte_code) {
+  for (auto ins : byte_code->instructions()) {
+    if (isDynamicScope(ins)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool ScopeAnalysis::isDescendant(Bytecode *byte_code, Bytecode *ancestor) {
+  for (Bytecode *parent = byte_code->parent(); parent != nullptr;
+       parent = parent->parent()) {
+    if (parent == ancestor) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Number of leading literals which are decoded as operands
+ */
+size_t ScopeAnalysis::operandLiterals(Ins *ins) {
+  OpcodeData data = ins->opcode().opcodeData();
+
+  switch (data.operands()) {
+  case OperandType::LITERAL:
+  case OperandType::STACK_LITERAL:
+  case OperandType::THIS_LITERAL: {
+    return 1;
+  }
+  case OperandType::LITERAL_LITERAL: {
+    return data.groupOpcode() == VM_OC_PUSH_THREE ? 3 : 2;
+  }
+  default: {
+    return 0;
+  }
+  }
+}
+
+/**
+ * Every reference to the identifier in the region would address a register
+ * the same way
+ */
+bool ScopeAnalysis::isPromotable(InsList &region, LiteralIndex ident,
+                                 IdentAccesses &accesses) {
+  for (auto ins : region) {
+    auto &literals = ins->argument().literals();
+    OpcodeData data = ins->opcode().opcodeData();
+
+    for (size_t i = 0; i < literals.size(); i++) {
+      if (literals[i].index() != ident) {
+        continue;
+      }
+
+      switch (data.groupOpcode()) {
+      case VM_OC_CREATE_BINDING: {
+        accesses.declarations.push_back(ins);
+        continue;
+      }
+      case VM_OC_ASSIGN_LET_CONST:
+      case VM_OC_INIT_BINDING: {
+        if (i + 1 != literals.size()) {
+          return false;
+        }
+
+        accesses.initializations.push_back(ins);
+        continue;
+      }
+      case VM_OC_IDENT_REFERENCE:
+      case VM_OC_TYPEOF_IDENT: {
+        accesses.uses.push_back(ins);
+        continue;
+      }
+      default: {
+        break;
+      }
+      }
+
+      /* operands and destinations are resolved the same way for registers
+         and identifiers */
+      bool is_destination = data.isPutIdent() && i + 1 == literals.size();
+
+      if (i >= operandLiterals(ins) && !is_destination) {
+        return false;
+      }
+
+      accesses.uses.push_back(ins);
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Move the identifier into a new register within the region, which must be a
+ * copy of the instructions
+ */
+void ScopeAnalysis::promote(Bytecode *byte_code, InsList &region,
+                            LiteralIndex ident) {
+  LOG("Promote identifier: " << ident);
+
+  LiteralIndex reg = byte_code->addRegister();
+  ident++;
+
+  InsList declarations;
+
+  for (auto ins : region) {
+    bool changed = false;
+
+    for (auto &literal : ins->argument().literals()) {
+      if (literal.index() == ident) {
+        literal = Literal(LiteralType::REGISTER, reg);
+        changed = true;
+      }
+    }
+
+    if (!changed) {
+      continue;
+    }
+
+    switch (ins->opcode().opcodeData().groupOpcode()) {
+    case VM_OC_CREATE_BINDING: {
+      declarations.push_back(ins);
+      continue;
+    }
+    case VM_OC_ASSIGN_LET_CONST: {
+      ins->opcode() = Opcode(ins->opcode().is(CBC_ASSIGN_LET_CONST)
+                                 ? CBC_MOV_IDENT
+                                 : CBC_ASSIGN_LITERAL_SET_IDENT);
+      break;
+    }
+    case VM_OC_INIT_BINDING: {
+      ins->opcode() = Opcode(CBC_MOV_IDENT);
+      break;
+    }
+    default: {
+      break;
+    }
+    }
+
+    ins->updateRegisters();
+  }
+
+  /* registers start as undefined, like a new 'var' binding */
+  for (auto ins : declarations) {
+    region.erase(std::find(region.begin(), region.end(), ins));
+    byte_code->removeIns(ins);
+  }
+}
+
+} // namespace optimizer
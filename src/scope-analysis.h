@@ -0,0 +1,45 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef SCOPE_ANALYSIS_H
+#define SCOPE_ANALYSIS_H
+
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+
+namespace optimizer {
+
+/**
+ * Instructions of a region which refer to an identifier
+ */
+struct IdentAccesses {
+  InsList declarations;
+  InsList initializations;
+  InsList uses;
+};
+
+/**
+ * Queries about the identifier bindings a function and its nested functions
+ * may refer to
+ */
+class ScopeAnalysis {
+public:
+  static bool isDynamicScope(Ins *ins);
+  static bool hasDynamicScope(Bytecode *byte_code);
+  static bool isDescendant(Bytecode *byte_code, Bytecode *ancestor);
+  static size_t operandLiterals(Ins *ins);
+  static bool isPromotable(InsList &region, LiteralIndex ident,
+                           IdentAccesses &accesses);
+  static void promote(Bytecode *byte_code, InsList &region,
+                      LiteralIndex ident);
+};
+
+} // namespace optimizer
+
+#endif // SCOPE_ANALYSIS_H
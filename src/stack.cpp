@@ -34,6 +34,26 @@ void Stack::push(ValueRef value) {
   // data_.push_back(value);
 }
 
+void Stack::pushContext(uint32_t size) {
+  contexts_.push_back(size);
+  push(size);
+}
+
+void Stack::extendContext(uint32_t size) {
+  assert(!contexts_.empty());
+  contexts_.back() += size;
+  push(size);
+}
+
+void Stack::popContext() {
+  if (contexts_.empty()) {
+    return;
+  }
+
+  pop(contexts_.back());
+  contexts_.pop_back();
+}
+
 void Stack::resetOperands() {
   setLeft(Value::_undefined());
   setRight(Value::_undefined());
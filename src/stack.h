@@ -65,6 +65,10 @@ public:
   void push(size_t count);
   void push(ValueRef value);
 
+  void pushContext(uint32_t size);
+  void extendContext(uint32_t size);
+  void popContext();
+
 private:
   ValueRefList data_;
   ValueRefList registers_;
@@ -74,6 +78,8 @@ private:
   ValueRef result_;
   ValueRef left_;
   ValueRef right_;
+  /* stack allocations of the contexts closed by a CONTEXT_END */
+  std::vector<uint32_t> contexts_;
 };
 
 } // namespace optimizer
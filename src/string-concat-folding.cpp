@@ -0,0 +1,215 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "string-concat-folding.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+StringConcatFolding::StringConcatFolding() : Pass() {}
+
+StringConcatFolding::~StringConcatFolding() {}
+
+bool StringConcatFolding::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::CONTROL_FLOW_ANALYSIS));
+
+  for (auto bb : byte_code->basicBlockList()) {
+    InsList &insns = bb->insns();
+    size_t i = 0;
+
+    while (i < insns.size()) {
+      if (!fold(optimizer, byte_code, insns, i)) {
+        i++;
+        continue;
+      }
+
+      /* the folded string may be concatenated again by the previous one */
+      if (i > 0) {
+        i--;
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Rewrite
+ *
+ *   CONCAT_TWO_LITERALS "a" "b"                -> PUSH_LITERAL "ab"
+ *   PUSH_LITERAL "a"; CONCAT_RIGHT_LITERAL "b" -> PUSH_LITERAL "ab"
+ *   PUSH_TWO_LITERALS "a" "b"; CONCAT          -> PUSH_LITERAL "ab"
+ *   CONCAT_*_LITERAL x "a";
+ *   CONCAT_RIGHT_LITERAL "b"                   -> CONCAT_*_LITERAL x "ab"
+ *
+ * where CONCAT is either an ADD or a STRING_CONCAT. A string concatenated
+ * to a string is appended in both cases, so the second operation may
+ * differ from the first one.
+ */
+bool StringConcatFolding::fold(Optimizer *optimizer, Bytecode *byte_code,
+                               InsList &insns, size_t start) {
+  Ins *ins = insns[start];
+
+  if (ins->hasFlag(InstFlags::DEAD)) {
+    return false;
+  }
+
+  auto &literals = ins->argument().literals();
+  LiteralIndex result;
+
+  if (isConcat(ins) && ins->argument().isLiteralLiteral() &&
+      isString(byte_code, literals[0]) && isString(byte_code, literals[1])) {
+    if (!concat(optimizer, byte_code, literals[0].index(),
+                literals[1].index(), result)) {
+      return false;
+    }
+
+    LOG("Fold string concatenation: " << *ins);
+    Ins *push = Ins::create(byte_code, Opcode(CBC_PUSH_LITERAL),
+                            {Literal(LiteralType::CONSTANT, result)});
+    byte_code->replaceIns(ins, push);
+    return true;
+  }
+
+  if (start + 1 >= insns.size()) {
+    return false;
+  }
+
+  Ins *next = insns[start + 1];
+
+  if (next->hasFlag(InstFlags::DEAD) || !isConcat(next)) {
+    return false;
+  }
+
+  Ins *folded;
+
+  if (next->argument().type() == OperandType::STACK_STACK) {
+    if (!ins->opcode().is(CBC_PUSH_TWO_LITERALS) ||
+        !isString(byte_code, literals[0]) ||
+        !isString(byte_code, literals[1]) ||
+        !concat(optimizer, byte_code, literals[0].index(),
+                literals[1].index(), result)) {
+      return false;
+    }
+
+    folded = Ins::create(byte_code, Opcode(CBC_PUSH_LITERAL),
+                         {Literal(LiteralType::CONSTANT, result)});
+  } else {
+    Literal &right = next->argument().literals()[0];
+
+    bool pushes_string = ins->opcode().is(CBC_PUSH_LITERAL) ||
+                         (isConcat(ins) && ins->argument().isLiteral());
+
+    if (next->argument().type() != OperandType::STACK_LITERAL ||
+        !pushes_string || !isString(byte_code, right) ||
+        !isString(byte_code, literals.back())) {
+      return false;
+    }
+
+    if (!concat(optimizer, byte_code, literals.back().index(), right.index(),
+                result)) {
+      return false;
+    }
+
+    /* the new constant may have moved the other literals */
+    std::vector<Literal> operands = ins->argument().literals();
+    operands.back() = Literal(LiteralType::CONSTANT, result);
+    folded = Ins::create(byte_code, ins->opcode(), operands);
+  }
+
+  LOG("Fold string concatenation: " << *ins << " and: " << *next);
+  byte_code->replaceIns(ins, folded);
+  byte_code->removeIns(next);
+  return true;
+}
+
+/**
+ * Constant holding the concatenation of the two string constants. The
+ * string is created in the literal storage of the engine, so it is saved
+ * into the snapshot as any other literal.
+ */
+bool StringConcatFolding::concat(Optimizer *optimizer, Bytecode *byte_code,
+                                 LiteralIndex left, LiteralIndex right,
+                                 LiteralIndex &result) {
+  BytecodeArguments &args = byte_code->args();
+  LiteralPool &pool = byte_code->literalPool();
+  ecma_string_t *left_string = ecma_get_string_from_value(pool.at(left));
+  ecma_string_t *right_string = ecma_get_string_from_value(pool.at(right));
+  lit_utf8_size_t left_size = ecma_string_get_size(left_string);
+  lit_utf8_size_t right_size = ecma_string_get_size(right_string);
+
+  if (left_size + right_size > STRING_CONCAT_FOLDING_MAX_SIZE) {
+    return false;
+  }
+
+  std::vector<lit_utf8_byte_t> buffer(left_size + right_size);
+  ecma_string_copy_to_cesu8_buffer(left_string, buffer.data(), left_size);
+  ecma_string_copy_to_cesu8_buffer(right_string, buffer.data() + left_size,
+                                   right_size);
+
+  ecma_value_t value =
+      ecma_find_or_create_literal_string(buffer.data(), left_size + right_size);
+
+  /* the literal storage returns the same value for the same string */
+  for (LiteralIndex i = args.identEnd(); i < args.constLiteralEnd(); i++) {
+    if (pool.at(i) == value) {
+      result = i;
+      return true;
+    }
+  }
+
+  result = byte_code->addConstant(value);
+  LOG("Add string literal: " << result);
+
+  /* sub functions are stored after the new constant */
+  for (auto sub_byte_code : optimizer->list()) {
+    if (sub_byte_code->parent() == byte_code) {
+      sub_byte_code->setParentLiteralPoolIndex(
+          sub_byte_code->parentLiteralPoolIndex() + 1);
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Concatenation whose result is pushed onto the stack
+ */
+bool StringConcatFolding::isConcat(Ins *ins) {
+  OpcodeData data = ins->opcode().opcodeData();
+
+  if (!data.isPutStack()) {
+    return false;
+  }
+
+  switch (data.groupOpcode()) {
+  case VM_OC_ADD:
+#if ENABLED(JERRY_ESNEXT)
+  case VM_OC_STRING_CONCAT:
+#endif /* ENABLED (JERRY_ESNEXT) */
+  {
+    return true;
+  }
+  default: {
+    return false;
+  }
+  }
+}
+
+/**
+ * String constant, the strings of the identifier range are names
+ */
+bool StringConcatFolding::isString(Bytecode *byte_code, Literal &literal) {
+  BytecodeArguments &args = byte_code->args();
+
+  return literal.index() >= args.identEnd() &&
+         literal.index() < args.constLiteralEnd() &&
+         ecma_is_value_string(byte_code->literalPool().at(literal.index()));
+}
+
+} // namespace optimizer
@@ -0,0 +1,50 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef STRING_CONCAT_FOLDING_H
+#define STRING_CONCAT_FOLDING_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+/* Longest folded string in bytes, longer ones are concatenated at runtime */
+#ifndef STRING_CONCAT_FOLDING_MAX_SIZE
+#define STRING_CONCAT_FOLDING_MAX_SIZE 256
+#endif /* !STRING_CONCAT_FOLDING_MAX_SIZE */
+
+class StringConcatFolding : public Pass {
+public:
+  StringConcatFolding();
+  ~StringConcatFolding();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "StringConcatFolding"; }
+
+  virtual PassKind kind() { return PassKind::STRING_CONCAT_FOLDING; }
+
+private:
+  bool fold(Optimizer *optimizer, Bytecode *byte_code, InsList &insns,
+            size_t start);
+  bool concat(Optimizer *optimizer, Bytecode *byte_code, LiteralIndex left,
+              LiteralIndex right, LiteralIndex &result);
+
+  static bool isConcat(Ins *ins);
+  static bool isString(Bytecode *byte_code, Literal &literal);
+};
+
+} // namespace optimizer
+
+#endif // STRING_CONCAT_FOLDING_H
@@ -0,0 +1,243 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "tdz-elimination.h"
+#include "dominator-analysis.h"
+#include "optimizer.h"
+#include "scope-analysis.h"
+
+namespace optimizer {
+
+TdzElimination::TdzElimination() : Pass() {}
+
+TdzElimination::~TdzElimination() {}
+
+bool TdzElimination::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::DOMINATOR_ANALYSIS));
+
+#if ENABLED(JERRY_ESNEXT)
+  /* the lexical bindings of the global code are shared between scripts */
+  if (!byte_code->flags().isFunction() ||
+      !collectClosures(optimizer, byte_code, closures_)) {
+    return true;
+  }
+
+  InsList assignments;
+
+  for (auto ins : byte_code->instructions()) {
+    if (ScopeAnalysis::isDynamicScope(ins)) {
+      return true;
+    }
+
+    if (ins->opcode().is(CBC_ASSIGN_LET_CONST)) {
+      assignments.push_back(ins);
+    }
+  }
+
+  for (auto assign : assignments) {
+    Ins *create = findBinding(byte_code, assign);
+
+    if (create == nullptr || !isInitialized(byte_code, create, assign)) {
+      continue;
+    }
+
+    LOG("Remove TDZ of binding: " << *assign);
+
+    /* the binding is created together with its value */
+    assign->opcode() = Opcode(create->opcode().is(CBC_CREATE_CONST)
+                                  ? CBC_INIT_CONST
+                                  : CBC_INIT_LET);
+    byte_code->removeIns(create);
+  }
+#endif /* ENABLED (JERRY_ESNEXT) */
+
+  return true;
+}
+
+/**
+ * Collect the identifiers which the nested functions and their descendants
+ * may refer to, an eval in them may refer to any binding
+ */
+bool TdzElimination::collectClosures(Optimizer *optimizer,
+                                     Bytecode *byte_code,
+                                     ClosureIdents &closures) {
+  closures.clear();
+
+  for (auto function : optimizer->list()) {
+    if (!ScopeAnalysis::isDescendant(function, byte_code)) {
+      continue;
+    }
+
+    if (ScopeAnalysis::hasDynamicScope(function)) {
+      return false;
+    }
+
+    Bytecode *child = function;
+
+    while (child->parent() != byte_code) {
+      child = child->parent();
+    }
+
+    LiteralIndex closure =
+        byte_code->args().registerEnd() + child->parentLiteralPoolIndex();
+    BytecodeArguments &args = function->args();
+
+    for (LiteralIndex i = args.registerEnd(); i < args.identEnd(); i++) {
+      closures[closure].insert(function->literalPool().at(i));
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Literal index of the binding which a declaration or an initialization
+ * refers to, the value of the literal forms is encoded first
+ */
+LiteralIndex TdzElimination::binding(Ins *ins) {
+  return ins->argument().literals().back().index();
+}
+
+#if ENABLED(JERRY_ESNEXT)
+/**
+ * The 'let' or 'const' declaration of the binding, if the binding has no
+ * other declaration in the function
+ */
+Ins *TdzElimination::findBinding(Bytecode *byte_code, Ins *assign) {
+  LiteralIndex index = binding(assign);
+  Ins *create = nullptr;
+
+  for (auto ins : byte_code->instructions()) {
+    if (ins == assign || ins->argument().literals().empty()) {
+      continue;
+    }
+
+    GroupOpcode group = ins->opcode().opcodeData().groupOpcode();
+
+    /* the destination of INIT_ARG_OR_FUNC is encoded first */
+    if ((group == VM_OC_INIT_ARG_OR_FUNC
+             ? ins->argument().literals().front().index()
+             : binding(ins)) != index) {
+      continue;
+    }
+
+    switch (group) {
+    case VM_OC_CREATE_BINDING: {
+      if (create != nullptr || (!ins->opcode().is(CBC_CREATE_LET) &&
+                                !ins->opcode().is(CBC_CREATE_CONST))) {
+        return nullptr;
+      }
+
+      create = ins;
+      break;
+    }
+    case VM_OC_ASSIGN_LET_CONST:
+    case VM_OC_INIT_BINDING:
+    case VM_OC_INIT_ARG_OR_FUNC: {
+      return nullptr;
+    }
+    default: {
+      break;
+    }
+    }
+  }
+
+  return create;
+}
+#endif /* ENABLED (JERRY_ESNEXT) */
+
+/**
+ * The binding is declared and assigned in the same lexical environment and
+ * the assignment dominates every use of it
+ */
+bool TdzElimination::isInitialized(Bytecode *byte_code, Ins *create,
+                                   Ins *assign) {
+  if (create->bb() != assign->bb()) {
+    return false;
+  }
+
+  BasicBlock *bb = assign->bb();
+  LiteralIndex index = binding(assign);
+  bool created = false;
+  bool assigned = false;
+
+  for (auto ins : bb->insns()) {
+    if (ins == create) {
+      created = true;
+      continue;
+    }
+
+    if (ins == assign) {
+      assigned = true;
+      break;
+    }
+
+    if (!created) {
+      continue;
+    }
+
+    switch (ins->opcode().opcodeData().groupOpcode()) {
+    case VM_OC_BLOCK_CREATE_CONTEXT:
+    case VM_OC_WITH:
+    case VM_OC_CONTEXT_END: {
+      return false;
+    }
+    default: {
+      break;
+    }
+    }
+  }
+
+  if (!created || !assigned) {
+    return false;
+  }
+
+  assigned = false;
+
+  for (auto ins : byte_code->instructions()) {
+    if (ins == assign) {
+      assigned = true;
+      continue;
+    }
+
+    if (ins == create || !isUse(byte_code, ins, index)) {
+      continue;
+    }
+
+    if (ins->bb() == bb ? !assigned
+                        : !DominatorAnalysis::dominatedBy(ins->bb(), bb)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * The instruction refers to the binding, or creates a closure which does
+ */
+bool TdzElimination::isUse(Bytecode *byte_code, Ins *ins,
+                           LiteralIndex index) {
+  ecma_value_t name = byte_code->literalPool().at(index);
+
+  for (auto &literal : ins->argument().literals()) {
+    if (literal.index() == index) {
+      return true;
+    }
+
+    auto iter = closures_.find(literal.index());
+
+    if (iter != closures_.end() && iter->second.count(name) != 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+} // namespace optimizer
@@ -0,0 +1,51 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef TDZ_ELIMINATION_H
+#define TDZ_ELIMINATION_H
+
+#include "basic-block.h"
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+/* identifiers referenced by each nested function, by its literal index */
+using ClosureIdents =
+    std::unordered_map<LiteralIndex, std::unordered_set<ecma_value_t>>;
+
+class TdzElimination : public Pass {
+public:
+  TdzElimination();
+  ~TdzElimination();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "TdzElimination"; }
+
+  virtual PassKind kind() { return PassKind::TDZ_ELIMINATION; }
+
+  static bool collectClosures(Optimizer *optimizer, Bytecode *byte_code,
+                              ClosureIdents &closures);
+  static LiteralIndex binding(Ins *ins);
+
+private:
+  Ins *findBinding(Bytecode *byte_code, Ins *assign);
+  bool isInitialized(Bytecode *byte_code, Ins *create, Ins *assign);
+  bool isUse(Bytecode *byte_code, Ins *ins, LiteralIndex index);
+
+  ClosureIdents closures_;
+};
+
+} // namespace optimizer
+
+#endif // TDZ_ELIMINATION_H
@@ -0,0 +1,99 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#include "unused-result-elimination.h"
+#include "basic-block.h"
+#include "optimizer.h"
+
+namespace optimizer {
+
+UnusedResultElimination::UnusedResultElimination() : Pass() {}
+
+UnusedResultElimination::~UnusedResultElimination() {}
+
+bool UnusedResultElimination::run(Optimizer *optimizer, Bytecode *byte_code) {
+  assert(optimizer->isSucceeded(PassKind::CONTROL_FLOW_ANALYSIS));
+
+  for (auto bb : byte_code->basicBlockList()) {
+    InsList &insns = bb->insns();
+
+    for (size_t i = 0; i + 1 < insns.size(); i++) {
+      Ins *ins = insns[i];
+      Ins *next = insns[i + 1];
+      CBCOpcode opcode;
+
+      if (ins->hasFlag(InstFlags::DEAD) ||
+          next->opcode().CBCopcode() != CBC_POP ||
+          !withoutResult(ins->opcode(), opcode)) {
+        continue;
+      }
+
+      Ins *new_ins =
+          Ins::create(byte_code, Opcode(opcode), ins->argument().literals());
+
+      if (ins->argument().hasByteArg()) {
+        new_ins->argument().setByteArg(ins->argument().byteArg());
+      }
+
+      LOG("Unused result: " << *ins);
+
+      byte_code->replaceIns(ins, new_ins);
+      byte_code->removeIns(next);
+    }
+  }
+
+  return true;
+}
+
+/**
+ * The variant without the stack result directly precedes the pushing one
+ */
+bool UnusedResultElimination::withoutResult(Opcode &opcode,
+                                            CBCOpcode &result) {
+  OpcodeData data = opcode.opcodeData();
+
+  if (!data.isPutStack() || Opcode::decodeIndex(opcode.CBCopcode()) == 0) {
+    return false;
+  }
+
+  CBCOpcode candidate = static_cast<CBCOpcode>(opcode.CBCopcode() - 1);
+  data.removeFlag(ResultFlag::STACK);
+
+  if (Opcode::isExtOpcode(candidate) != opcode.isExtOpcode() ||
+      Opcode(candidate).opcodeData().data() != data.data()) {
+    return false;
+  }
+
+  /* without a result the postfix and prefix forms are the same */
+  switch (candidate) {
+  case CBC_POST_INCR: {
+    result = CBC_PRE_INCR;
+    break;
+  }
+  case CBC_POST_DECR: {
+    result = CBC_PRE_DECR;
+    break;
+  }
+  case CBC_POST_INCR_IDENT: {
+    result = CBC_PRE_INCR_IDENT;
+    break;
+  }
+  case CBC_POST_DECR_IDENT: {
+    result = CBC_PRE_DECR_IDENT;
+    break;
+  }
+  default: {
+    result = candidate;
+    break;
+  }
+  }
+
+  return true;
+}
+
+} // namespace optimizer
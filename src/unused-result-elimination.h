@@ -0,0 +1,38 @@
+/* Copyright (c) 2020 Robert Fancsik
+ *
+ * Licensed under the BSD 3-Clause License
+ * <LICENSE or https://opensource.org/licenses/BSD-3-Clause>.
+ * This file may not be copied, modified, or distributed except
+ * according to those terms.
+ */
+
+#ifndef UNUSED_RESULT_ELIMINATION_H
+#define UNUSED_RESULT_ELIMINATION_H
+
+#include "bytecode.h"
+#include "common.h"
+#include "inst.h"
+#include "pass.h"
+
+namespace optimizer {
+
+class Optimizer;
+
+class UnusedResultElimination : public Pass {
+public:
+  UnusedResultElimination();
+  ~UnusedResultElimination();
+
+  virtual bool run(Optimizer *optimizer, Bytecode *byte_code);
+
+  virtual const char *name() { return "UnusedResultElimination"; }
+
+  virtual PassKind kind() { return PassKind::UNUSED_RESULT_ELIMINATION; }
+
+private:
+  static bool withoutResult(Opcode &opcode, CBCOpcode &result);
+};
+
+} // namespace optimizer
+
+#endif // UNUSED_RESULT_ELIMINATION_H